@@ -18,6 +18,11 @@ namespace constants
     constexpr int CELL_SIZE_IN_SQUARE = CELL_SIZE_IN_BLOCKS * BLOCK_SIZE_IN_SQUARE;
     constexpr int BLOCKS_PER_CELL = CELL_SIZE_IN_BLOCKS * CELL_SIZE_IN_BLOCKS;
 
+    // B41 cells cover 300x300 squares: 30x30 chunks of 10x10 squares
+    constexpr int B41_BLOCK_SIZE_IN_SQUARE = 10;
+    constexpr int B41_CELL_SIZE_IN_BLOCKS = 30;
+    constexpr int B41_BLOCKS_PER_CELL = B41_CELL_SIZE_IN_BLOCKS * B41_CELL_SIZE_IN_BLOCKS;
+
     constexpr char LINE_END = 0xA;
 
     const std::string GAME_PATH_B42 = "C:/Program Files (x86)/Steam/steamapps/common/ProjectZomboid";
@@ -0,0 +1,30 @@
+#include "cell.h"
+
+#include <utility>
+
+Cell::Cell(LotHeader _header) : header(std::move(_header)), lotpack(&header) {}
+
+Cell::Cell(Cell &&other) noexcept : header(std::move(other.header)), lotpack(std::move(other.lotpack))
+{
+    lotpack.header = &header;
+}
+
+Cell &Cell::operator=(Cell &&other) noexcept
+{
+    if (this != &other)
+    {
+        header = std::move(other.header);
+        lotpack = std::move(other.lotpack);
+        lotpack.header = &header;
+    }
+
+    return *this;
+}
+
+std::unique_ptr<Cell> Cell::read(BytesView lotheaderBuffer, BytesView lotpackBuffer, Vector2i position)
+{
+    auto cell = std::make_unique<Cell>(LotHeader::read(lotheaderBuffer, position));
+    cell->lotpack = Lotpack::read(lotpackBuffer, &cell->header);
+
+    return cell;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "math/vector2i.h"
+#include "types.h"
+
+// Lotheader and lotpack of one cell. The lotpack points to the header of the
+// same cell: moves rebind it, copies are disabled since a decoded cell is
+// large. Cells are kept behind a unique_ptr so their address never changes.
+class Cell
+{
+public:
+    LotHeader header;
+    Lotpack lotpack;
+
+    explicit Cell(LotHeader _header);
+
+    Cell(const Cell &) = delete;
+    Cell &operator=(const Cell &) = delete;
+
+    Cell(Cell &&other) noexcept;
+    Cell &operator=(Cell &&other) noexcept;
+
+    static std::unique_ptr<Cell> read(BytesView lotheaderBuffer, BytesView lotpackBuffer, Vector2i position);
+};
@@ -0,0 +1,217 @@
+#include "map_diff.h"
+
+#include <algorithm>
+#include <span>
+#include <utility>
+
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "threading/parallel.h"
+
+namespace
+{
+    // squares of a block sorted by position, with the registry ids of the
+    // block tiles, tileIds[0] being the first tile of the block
+    struct BlockSquares
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> positions; // packed position, square
+        Lotpack::SquareView table;
+        std::vector<uint32_t> tileIds;
+    };
+
+    BlockSquares sortedSquares(const LotHeader &header, Lotpack::SquareView table)
+    {
+        BlockSquares block;
+        block.table = table;
+
+        std::span<const int32_t> tiles = table.tiles.subspan(table.tileOffsets.front(), table.tileOffsets.back() - table.tileOffsets.front());
+        block.tileIds.resize(tiles.size());
+        header.toGlobalTileIds(tiles, block.tileIds);
+
+        block.positions.reserve(table.size());
+        for (uint32_t square = 0; square < table.size(); square++)
+        {
+            CellCoord coord = table.coords[square];
+            uint32_t position = (static_cast<uint32_t>(coord.z() + 128) << 16) | (static_cast<uint32_t>(coord.x()) << 8) | static_cast<uint32_t>(coord.y());
+            block.positions.emplace_back(position, square);
+        }
+
+        std::sort(block.positions.begin(), block.positions.end());
+        return block;
+    }
+
+    bool sameSquare(const BlockSquares &before, uint32_t beforeSquare, const BlockSquares &after, uint32_t afterSquare)
+    {
+        if (before.table.roomIds[beforeSquare] != after.table.roomIds[afterSquare])
+            return false;
+
+        auto tiles = [](const BlockSquares &block, uint32_t square)
+        {
+            std::span<const uint32_t> offsets = block.table.tileOffsets;
+            return std::span(block.tileIds).subspan(offsets[square] - offsets.front(), offsets[square + 1] - offsets[square]);
+        };
+
+        return std::ranges::equal(tiles(before, beforeSquare), tiles(after, afterSquare));
+    }
+
+    uint32_t changedSquares(const BlockSquares &before, const BlockSquares &after)
+    {
+        uint32_t changed = 0;
+        size_t i = 0;
+        size_t j = 0;
+
+        while (i < before.positions.size() || j < after.positions.size())
+        {
+            if (j == after.positions.size() || (i < before.positions.size() && before.positions[i].first < after.positions[j].first))
+            {
+                changed++;
+                i++;
+            }
+            else if (i == before.positions.size() || after.positions[j].first < before.positions[i].first)
+            {
+                changed++;
+                j++;
+            }
+            else
+            {
+                if (!sameSquare(before, before.positions[i].second, after, after.positions[j].second))
+                    changed++;
+
+                i++;
+                j++;
+            }
+        }
+
+        return changed;
+    }
+
+    MapDiff::CellChange compareCell(const MapManifest &before, const MapManifest::Cell &beforeCell, const MapManifest &after, const MapManifest::Cell &afterCell)
+    {
+        MapDiff::CellChange change{ beforeCell.position, MapDiff::CellStatus::Changed, false, {} };
+        change.headerChanged = !(beforeCell.lotheader.hash == afterCell.lotheader.hash);
+
+        LotHeader beforeHeader = LotHeader::read(before.lotheaderPath(beforeCell), LotHeader::SECTION_TILE_NAMES);
+        LotHeader afterHeader = LotHeader::read(after.lotheaderPath(afterCell), LotHeader::SECTION_TILE_NAMES);
+
+        if (beforeHeader.isB41() != afterHeader.isB41())
+        {
+            change.status = MapDiff::CellStatus::FormatChanged;
+            return change;
+        }
+
+        Lotpack beforeLotpack = Lotpack::open(before.lotpackPath(beforeCell), &beforeHeader);
+        Lotpack afterLotpack = Lotpack::open(after.lotpackPath(afterCell), &afterHeader);
+
+        // cells are already compared in parallel
+        std::vector<uint64_t> beforeHashes = beforeLotpack.blockHashes(1);
+        std::vector<uint64_t> afterHashes = afterLotpack.blockHashes(1);
+
+        int cellSize = beforeHeader.cellSizeInBlocks();
+        Lotpack::SquareTable emptyTable;
+
+        for (uint32_t block = 0; block < std::max(beforeHashes.size(), afterHashes.size()); block++)
+        {
+            bool inBefore = block < beforeHashes.size();
+            bool inAfter = block < afterHashes.size();
+
+            if (inBefore && inAfter && beforeHashes[block] == afterHashes[block])
+                continue;
+
+            BlockSquares beforeSquares = sortedSquares(beforeHeader, inBefore ? beforeLotpack.loadBlock(block) : emptyTable.view());
+            BlockSquares afterSquares = sortedSquares(afterHeader, inAfter ? afterLotpack.loadBlock(block) : emptyTable.view());
+
+            change.chunks.push_back(MapDiff::ChunkChange{
+                static_cast<int32_t>(block / cellSize),
+                static_cast<int32_t>(block % cellSize),
+                static_cast<uint32_t>(beforeSquares.positions.size()),
+                static_cast<uint32_t>(afterSquares.positions.size()),
+                changedSquares(beforeSquares, afterSquares),
+            });
+        }
+
+        return change;
+    }
+}
+
+MapDiff MapDiff::compare(const MapManifest &before, const MapManifest &after, size_t threads)
+{
+    MapDiff diff;
+
+    // manifests cells are sorted by position, pairs are found by merging both lists
+    std::vector<std::pair<const MapManifest::Cell *, const MapManifest::Cell *>> pairs;
+    size_t i = 0;
+    size_t j = 0;
+
+    auto lower = [](const Vector2i &a, const Vector2i &b)
+    {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    };
+
+    while (i < before.cells.size() || j < after.cells.size())
+    {
+        if (j == after.cells.size() || (i < before.cells.size() && lower(before.cells[i].position, after.cells[j].position)))
+        {
+            diff.cells.push_back(CellChange{ before.cells[i++].position, CellStatus::Removed, false, {} });
+        }
+        else if (i == before.cells.size() || lower(after.cells[j].position, before.cells[i].position))
+        {
+            diff.cells.push_back(CellChange{ after.cells[j++].position, CellStatus::Added, false, {} });
+        }
+        else
+        {
+            const MapManifest::Cell &beforeCell = before.cells[i++];
+            const MapManifest::Cell &afterCell = after.cells[j++];
+
+            if (beforeCell.lotheader.hash == afterCell.lotheader.hash && beforeCell.lotpack.hash == afterCell.lotpack.hash)
+            {
+                diff.identicalCells++;
+                continue;
+            }
+
+            pairs.emplace_back(&beforeCell, &afterCell);
+        }
+    }
+
+    std::vector<CellChange> changes(pairs.size());
+
+    Parallel::forEach(pairs.size(), [&](size_t pair)
+    {
+        changes[pair] = compareCell(before, *pairs[pair].first, after, *pairs[pair].second);
+    }, threads);
+
+    for (CellChange &change : changes)
+    {
+        // same lotheader, the lotpack bytes differ but every block hashes the same
+        if (change.status == CellStatus::Changed && !change.headerChanged && change.chunks.empty())
+        {
+            diff.identicalCells++;
+            continue;
+        }
+
+        diff.cells.push_back(std::move(change));
+    }
+
+    std::sort(diff.cells.begin(), diff.cells.end(), [&](const CellChange &a, const CellChange &b)
+    {
+        return lower(a.position, b.position);
+    });
+
+    return diff;
+}
+
+MapDiff MapDiff::compare(const std::string &beforeDirectory, const std::string &afterDirectory, size_t threads)
+{
+    return compare(MapManifest::load(beforeDirectory, threads), MapManifest::load(afterDirectory, threads), threads);
+}
+
+size_t MapDiff::changedChunksCount() const
+{
+    size_t count = 0;
+
+    for (const CellChange &cell : cells)
+    {
+        count += cell.chunks.size();
+    }
+
+    return count;
+}
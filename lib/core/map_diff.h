@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "files/map_manifest.h"
+#include "math/vector2i.h"
+
+// Differences between two versions of a map directory. Cells whose files
+// have the same manifest hashes are skipped, the others are compared chunk
+// by chunk through Lotpack::blockHashes and only the chunks with different
+// hashes are decoded to count the modified squares.
+class MapDiff
+{
+public:
+    enum class CellStatus
+    {
+        Added,
+        Removed,
+        Changed,
+        FormatChanged, // B41 on one side and B42 on the other, chunks are not comparable
+    };
+
+    struct ChunkChange
+    {
+        int32_t chunkX;
+        int32_t chunkY;
+        uint32_t squaresBefore;
+        uint32_t squaresAfter;
+        uint32_t squaresChanged; // added, removed or with other rooms or tiles
+    };
+
+    struct CellChange
+    {
+        Vector2i position;
+        CellStatus status;
+        bool headerChanged = false;
+        std::vector<ChunkChange> chunks;
+    };
+
+    size_t identicalCells = 0;
+    std::vector<CellChange> cells; // sorted by position
+
+    static MapDiff compare(const MapManifest &before, const MapManifest &after, size_t threads = 0);
+    static MapDiff compare(const std::string &beforeDirectory, const std::string &afterDirectory, size_t threads = 0);
+
+    size_t changedChunksCount() const;
+};
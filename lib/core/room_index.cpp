@@ -0,0 +1,246 @@
+#include "room_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace
+{
+    inline int32_t floorDiv(int32_t value, int32_t divisor)
+    {
+        int32_t quotient = value / divisor;
+        return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+    }
+
+    inline int64_t squaredDistance(const RoomIndex::Box &box, int32_t x, int32_t y)
+    {
+        int64_t dx = std::max({ static_cast<int64_t>(box.x0) - x, int64_t{ 0 }, static_cast<int64_t>(x) - (box.x1 - 1) });
+        int64_t dy = std::max({ static_cast<int64_t>(box.y0) - y, int64_t{ 0 }, static_cast<int64_t>(y) - (box.y1 - 1) });
+
+        return dx * dx + dy * dy;
+    }
+}
+
+RoomIndex::RoomIndex(int32_t _bucketSize, int32_t _cellSize) : bucketSize(_bucketSize), cellSize(_cellSize)
+{
+    if (bucketSize <= 0)
+    {
+        throw std::invalid_argument("bucket size must be positive");
+    }
+
+    bucketOffsets = { 0 };
+}
+
+void RoomIndex::addCell(const LotHeader &header)
+{
+    if (!header.hasSections(LotHeader::SECTION_ROOMS | LotHeader::SECTION_BUILDINGS))
+    {
+        throw std::runtime_error("room index needs the rooms and buildings sections");
+    }
+
+    const LotHeader::RoomTable &table = header.rooms;
+    std::vector<int32_t> buildingOfRoom(table.roomsCount(), -1);
+
+    for (size_t building = 0; building < table.buildingsCount(); building++)
+    {
+        for (uint32_t roomId : table.buildingRooms(building))
+        {
+            if (roomId < buildingOfRoom.size())
+                buildingOfRoom[roomId] = static_cast<int32_t>(building);
+        }
+    }
+
+    int32_t originX = header.position.x * cellSize;
+    int32_t originY = header.position.y * cellSize;
+
+    for (size_t room = 0; room < table.roomsCount(); room++)
+    {
+        uint32_t roomIndex = static_cast<uint32_t>(rooms.size());
+        rooms.push_back(RoomRef{ header.position, static_cast<uint32_t>(room), buildingOfRoom[room], static_cast<int32_t>(table.layers[room]) });
+
+        for (const LotHeader::Rectangle &rect : table.roomRectangles(room))
+        {
+            int32_t x = originX + static_cast<int32_t>(rect.x);
+            int32_t y = originY + static_cast<int32_t>(rect.y);
+
+            boxes.push_back(Box{ x, y, x + static_cast<int32_t>(rect.width), y + static_cast<int32_t>(rect.heigth) });
+            boxRooms.push_back(roomIndex);
+        }
+    }
+}
+
+void RoomIndex::build()
+{
+    bucketsX = 0;
+    bucketsY = 0;
+    bucketOffsets = { 0 };
+    bucketBoxes.clear();
+
+    if (boxes.empty())
+        return;
+
+    bounds = Box{ INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    for (const Box &box : boxes)
+    {
+        bounds.x0 = std::min(bounds.x0, box.x0);
+        bounds.y0 = std::min(bounds.y0, box.y0);
+        bounds.x1 = std::max(bounds.x1, box.x1);
+        bounds.y1 = std::max(bounds.y1, box.y1);
+    }
+
+    bucketsX = (bounds.x1 - bounds.x0 + bucketSize - 1) / bucketSize;
+    bucketsY = (bounds.y1 - bounds.y0 + bucketSize - 1) / bucketSize;
+
+    // first pass counts the rectangles per bucket, second pass fills the buckets
+    bucketOffsets.assign(static_cast<size_t>(bucketsX) * bucketsY + 1, 0);
+
+    auto forEachBucket = [&](const Box &box, auto &&onBucket)
+    {
+        if (box.x1 <= box.x0 || box.y1 <= box.y0)
+            return;
+
+        for (int32_t by = bucketY(box.y0); by <= bucketY(box.y1 - 1); by++)
+        {
+            for (int32_t bx = bucketX(box.x0); bx <= bucketX(box.x1 - 1); bx++)
+            {
+                onBucket(bucketIndex(bx, by));
+            }
+        }
+    };
+
+    for (const Box &box : boxes)
+    {
+        forEachBucket(box, [&](size_t bucket) { bucketOffsets[bucket + 1]++; });
+    }
+
+    for (size_t i = 1; i < bucketOffsets.size(); i++)
+    {
+        bucketOffsets[i] += bucketOffsets[i - 1];
+    }
+
+    std::vector<uint32_t> fill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    bucketBoxes.resize(bucketOffsets.back());
+
+    for (uint32_t boxIndex = 0; boxIndex < boxes.size(); boxIndex++)
+    {
+        forEachBucket(boxes[boxIndex], [&](size_t bucket) { bucketBoxes[fill[bucket]++] = boxIndex; });
+    }
+}
+
+std::optional<uint32_t> RoomIndex::roomAt(int32_t x, int32_t y, int32_t layer) const
+{
+    if (bucketsX == 0 || !bounds.contains(x, y))
+        return std::nullopt;
+
+    size_t bucket = bucketIndex(bucketX(x), bucketY(y));
+
+    for (uint32_t i = bucketOffsets[bucket]; i < bucketOffsets[bucket + 1]; i++)
+    {
+        uint32_t boxIndex = bucketBoxes[i];
+
+        if (boxes[boxIndex].contains(x, y) && rooms[boxRooms[boxIndex]].layer == layer)
+            return boxRooms[boxIndex];
+    }
+
+    return std::nullopt;
+}
+
+void RoomIndex::queryRegion(const Box &region, std::vector<uint32_t> &output) const
+{
+    collectRegion(region, true, 0, output);
+}
+
+void RoomIndex::queryRegion(const Box &region, int32_t layer, std::vector<uint32_t> &output) const
+{
+    collectRegion(region, false, layer, output);
+}
+
+void RoomIndex::collectRegion(const Box &region, bool anyLayer, int32_t layer, std::vector<uint32_t> &output) const
+{
+    output.clear();
+
+    if (bucketsX == 0 || !bounds.intersects(region))
+        return;
+
+    Box clipped{ std::max(region.x0, bounds.x0), std::max(region.y0, bounds.y0), std::min(region.x1, bounds.x1), std::min(region.y1, bounds.y1) };
+
+    for (int32_t by = bucketY(clipped.y0); by <= bucketY(clipped.y1 - 1); by++)
+    {
+        for (int32_t bx = bucketX(clipped.x0); bx <= bucketX(clipped.x1 - 1); bx++)
+        {
+            size_t bucket = bucketIndex(bx, by);
+
+            for (uint32_t i = bucketOffsets[bucket]; i < bucketOffsets[bucket + 1]; i++)
+            {
+                uint32_t boxIndex = bucketBoxes[i];
+                uint32_t roomIndex = boxRooms[boxIndex];
+
+                if (boxes[boxIndex].intersects(region) && (anyLayer || rooms[roomIndex].layer == layer))
+                    output.push_back(roomIndex);
+            }
+        }
+    }
+
+    // a room spanning several buckets or rectangles is found more than once
+    std::sort(output.begin(), output.end());
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+}
+
+std::optional<RoomIndex::NearestBuilding> RoomIndex::nearestBuilding(int32_t x, int32_t y, int32_t maxDistance) const
+{
+    if (bucketsX == 0 || maxDistance < 0)
+        return std::nullopt;
+
+    std::optional<NearestBuilding> nearest;
+    int64_t bestDistance = static_cast<int64_t>(maxDistance) * maxDistance;
+
+    int32_t centerX = floorDiv(x - bounds.x0, bucketSize);
+    int32_t centerY = floorDiv(y - bounds.y0, bucketSize);
+
+    // rings of buckets around the point, a ring r is at least (r - 1) * bucketSize squares away
+    int32_t maxRing = maxDistance / bucketSize + 1;
+    maxRing = std::min(maxRing, std::max({ centerX, bucketsX - 1 - centerX, centerY, bucketsY - 1 - centerY }));
+
+    for (int32_t ring = 0; ring <= maxRing; ring++)
+    {
+        int64_t ringDistance = static_cast<int64_t>(std::max(ring - 1, 0)) * bucketSize;
+        if (ringDistance * ringDistance > bestDistance)
+            break;
+
+        for (int32_t by = centerY - ring; by <= centerY + ring; by++)
+        {
+            if (by < 0 || by >= bucketsY)
+                continue;
+
+            // inner rows only have the two side buckets of the ring
+            int32_t step = (by == centerY - ring || by == centerY + ring) ? 1 : std::max(2 * ring, 1);
+
+            for (int32_t bx = centerX - ring; bx <= centerX + ring; bx += step)
+            {
+                if (bx < 0 || bx >= bucketsX)
+                    continue;
+
+                size_t bucket = bucketIndex(bx, by);
+
+                for (uint32_t i = bucketOffsets[bucket]; i < bucketOffsets[bucket + 1]; i++)
+                {
+                    uint32_t boxIndex = bucketBoxes[i];
+                    const RoomRef &room = rooms[boxRooms[boxIndex]];
+
+                    if (room.building < 0)
+                        continue;
+
+                    int64_t distance = squaredDistance(boxes[boxIndex], x, y);
+
+                    if (distance <= bestDistance && (!nearest || distance < nearest->squaredDistance))
+                    {
+                        bestDistance = distance;
+                        nearest = NearestBuilding{ room.cell, room.building, distance };
+                    }
+                }
+            }
+        }
+    }
+
+    return nearest;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "math/vector2i.h"
+
+// Uniform grid over the room rectangles of every added cell, in world
+// square coordinates (cell position * cell size + local coordinates).
+// Each bucket lists the rectangles overlapping it, so point and region
+// queries only test the rectangles of the buckets they touch.
+class RoomIndex
+{
+public:
+    struct RoomRef
+    {
+        Vector2i cell;
+        uint32_t room;
+        int32_t building; // -1 when the room is not part of a building
+        int32_t layer;
+    };
+
+    // half-open box [x0, x1) x [y0, y1)
+    struct Box
+    {
+        int32_t x0;
+        int32_t y0;
+        int32_t x1;
+        int32_t y1;
+
+        inline bool contains(int32_t x, int32_t y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+        inline bool intersects(const Box &other) const { return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1; }
+    };
+
+    struct NearestBuilding
+    {
+        Vector2i cell;
+        int32_t building;
+        int64_t squaredDistance;
+    };
+
+private:
+    int32_t bucketSize;
+    int32_t cellSize;
+
+    std::vector<RoomRef> rooms;
+    std::vector<Box> boxes;
+    std::vector<uint32_t> boxRooms;
+
+    Box bounds{ 0, 0, 0, 0 };
+    int32_t bucketsX = 0;
+    int32_t bucketsY = 0;
+    std::vector<uint32_t> bucketOffsets;
+    std::vector<uint32_t> bucketBoxes;
+
+    inline int32_t bucketX(int32_t x) const { return (x - bounds.x0) / bucketSize; }
+    inline int32_t bucketY(int32_t y) const { return (y - bounds.y0) / bucketSize; }
+    inline size_t bucketIndex(int32_t bx, int32_t by) const { return static_cast<size_t>(by) * bucketsX + bx; }
+
+    void collectRegion(const Box &region, bool anyLayer, int32_t layer, std::vector<uint32_t> &output) const;
+
+public:
+    explicit RoomIndex(int32_t _bucketSize = 32, int32_t _cellSize = constants::CELL_SIZE_IN_SQUARE);
+
+    // headers need their rooms and buildings sections, build() must be called after adding cells
+    void addCell(const LotHeader &header);
+    void build();
+
+    inline size_t roomsCount() const { return rooms.size(); }
+    inline const RoomRef &getRoom(uint32_t roomIndex) const { return rooms[roomIndex]; }
+
+    // index of the room containing the square on that layer
+    std::optional<uint32_t> roomAt(int32_t x, int32_t y, int32_t layer) const;
+
+    // every room with a rectangle intersecting the region, each reported once, sorted
+    void queryRegion(const Box &region, std::vector<uint32_t> &output) const;
+    void queryRegion(const Box &region, int32_t layer, std::vector<uint32_t> &output) const;
+
+    // closest building by distance to its rooms rectangles, within maxDistance squares
+    std::optional<NearestBuilding> nearestBuilding(int32_t x, int32_t y, int32_t maxDistance) const;
+};
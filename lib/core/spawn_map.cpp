@@ -0,0 +1,131 @@
+#include "spawn_map.h"
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <lodepng.h>
+#include <stdexcept>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "io/file_reader.h"
+#include "threading/parallel.h"
+
+namespace fs = std::filesystem;
+
+SpawnMap SpawnMap::build(const std::vector<std::string> &lotheaderPaths, size_t threads)
+{
+    SpawnMap spawnMap;
+
+    if (lotheaderPaths.empty())
+        return spawnMap;
+
+    // bounds come from the file names, no file has to be opened for that
+    std::vector<Vector2i> positions(lotheaderPaths.size());
+    Vector2i minCell{ INT32_MAX, INT32_MAX };
+    Vector2i maxCell{ INT32_MIN, INT32_MIN };
+
+    for (size_t i = 0; i < lotheaderPaths.size(); i++)
+    {
+        positions[i] = LotHeader::getPositionFromFilename(lotheaderPaths[i]);
+
+        minCell.x = std::min(minCell.x, positions[i].x);
+        minCell.y = std::min(minCell.y, positions[i].y);
+        maxCell.x = std::max(maxCell.x, positions[i].x);
+        maxCell.y = std::max(maxCell.y, positions[i].y);
+    }
+
+    std::vector<LotHeader> headers(lotheaderPaths.size());
+
+    Parallel::forEach(lotheaderPaths.size(), [&](size_t i)
+    {
+        MappedFile file = FileReader::map(lotheaderPaths[i]);
+        headers[i] = LotHeader::read(file.view(), positions[i], LotHeader::SECTION_SPAWNS);
+    }, threads);
+
+    // B41 cells are 30x30 chunks and B42 cells 32x32, they can't share a raster
+    bool b41 = headers.front().isB41();
+    for (const LotHeader &header : headers)
+    {
+        if (header.isB41() != b41)
+            throw std::runtime_error("spawn map can't mix B41 and B42 lotheaders");
+    }
+
+    int32_t cellSize = headers.front().cellSizeInBlocks();
+
+    spawnMap.originCell = minCell;
+    spawnMap.cellSizeInChunks = cellSize;
+    spawnMap.widthInChunks = (maxCell.x - minCell.x + 1) * cellSize;
+    spawnMap.heightInChunks = (maxCell.y - minCell.y + 1) * cellSize;
+    spawnMap.density.assign(static_cast<size_t>(spawnMap.widthInChunks) * spawnMap.heightInChunks, 0);
+
+    // every cell writes its own block of the raster, no synchronization needed
+    Parallel::forEach(headers.size(), [&](size_t i)
+    {
+        const LotHeader &header = headers[i];
+
+        int32_t originX = (positions[i].x - minCell.x) * cellSize;
+        int32_t originY = (positions[i].y - minCell.y) * cellSize;
+
+        for (int32_t chunkY = 0; chunkY < cellSize; chunkY++)
+        {
+            uint8_t *row = spawnMap.density.data() + static_cast<size_t>(originY + chunkY) * spawnMap.widthInChunks + originX;
+
+            for (int32_t chunkX = 0; chunkX < cellSize; chunkX++)
+            {
+                row[chunkX] = header.spawnDensity(chunkX, chunkY);
+            }
+        }
+    }, threads);
+
+    return spawnMap;
+}
+
+SpawnMap SpawnMap::build(const std::string &mapDirectory, size_t threads)
+{
+    std::vector<std::string> paths;
+
+    for (auto &entry : fs::directory_iterator(mapDirectory))
+    {
+        if (entry.path().extension().string() == constants::LOTHEADER_EXT)
+        {
+            paths.push_back(entry.path().string());
+        }
+    }
+
+    return build(paths, threads);
+}
+
+uint8_t SpawnMap::at(int32_t chunkX, int32_t chunkY) const
+{
+    if (chunkX < 0 || chunkY < 0 || chunkX >= widthInChunks || chunkY >= heightInChunks)
+        return 0;
+
+    return density[static_cast<size_t>(chunkY) * widthInChunks + chunkX];
+}
+
+BytesBuffer SpawnMap::toPNG() const
+{
+    std::vector<unsigned char> pixels(density.size() * 4);
+
+    for (size_t i = 0; i < density.size(); i++)
+    {
+        pixels[i * 4 + 0] = density[i];
+        pixels[i * 4 + 1] = 0;
+        pixels[i * 4 + 2] = 0;
+        pixels[i * 4 + 3] = 255;
+    }
+
+    BytesBuffer png;
+    if (lodepng::encode(png, pixels, widthInChunks, heightInChunks) != 0)
+    {
+        throw std::runtime_error("failed encoding spawn map.");
+    }
+
+    return png;
+}
+
+void SpawnMap::savePNG(const std::string &filename) const
+{
+    FileReader::save(toPNG(), filename);
+}
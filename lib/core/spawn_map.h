@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "math/vector2i.h"
+#include "types.h"
+
+// Zombie spawn density of a whole map, one value per chunk, stitched from
+// the spawns section of every lotheader. This is the data painted in
+// Map_ZombieSpawnMap.png, one pixel per chunk. All the cells must use the
+// same format, B41 cells being 30 chunks wide instead of 32.
+class SpawnMap
+{
+public:
+    Vector2i originCell{ 0, 0 };
+    int32_t cellSizeInChunks = constants::CELL_SIZE_IN_BLOCKS;
+    int32_t widthInChunks = 0;
+    int32_t heightInChunks = 0;
+    std::vector<uint8_t> density; // row major, widthInChunks * heightInChunks
+
+    SpawnMap() = default;
+
+    // headers are decoded in parallel, threads = 0 uses every core
+    static SpawnMap build(const std::vector<std::string> &lotheaderPaths, size_t threads = 0);
+    static SpawnMap build(const std::string &mapDirectory, size_t threads = 0);
+
+    // chunk coordinates relative to originCell, 0 outside of the map
+    uint8_t at(int32_t chunkX, int32_t chunkY) const;
+
+    // density in the red channel, as in the game spawn maps
+    BytesBuffer toPNG() const;
+    void savePNG(const std::string &filename) const;
+};
@@ -0,0 +1,371 @@
+#include "sprite_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "constants.h"
+#include "core/tile_name_registry.h"
+#include "files/cell_cache.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
+#include "io/file_reader.h"
+#include "threading/parallel.h"
+
+namespace
+{
+    struct Usage
+    {
+        uint32_t spriteId;
+        uint64_t position;
+    };
+
+    inline void appendVarint(BytesBuffer &output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    inline uint64_t readVarint(BytesView input, size_t &offset)
+    {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (offset >= input.size())
+                throw std::runtime_error("sprite index postings are truncated");
+
+            uint8_t byte = input[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+
+        throw std::runtime_error("sprite index varint is too long");
+    }
+
+    // first position of the sorted range not lower than key, probing
+    // exponentially from begin since successive keys are close
+    const uint64_t *gallop(const uint64_t *begin, const uint64_t *end, uint64_t key)
+    {
+        size_t step = 1;
+        const uint64_t *low = begin;
+
+        while (begin + step < end && begin[step] < key)
+        {
+            low = begin + step;
+            step *= 2;
+        }
+
+        return std::lower_bound(low, std::min(begin + step + 1, end), key);
+    }
+
+    // tileIds maps the cell tile indices to registry ids
+    void collectUsages(Vector2i cell, bool b41, std::span<const CellCoord> coords, std::span<const uint32_t> tileOffsets,
+                       std::span<const int32_t> tiles, std::span<const uint32_t> tileIds, std::vector<Usage> &usages)
+    {
+        int blockSize = b41 ? constants::B41_BLOCK_SIZE_IN_SQUARE : constants::BLOCK_SIZE_IN_SQUARE;
+        int cellSize = b41 ? constants::B41_CELL_SIZE_IN_BLOCKS : constants::CELL_SIZE_IN_BLOCKS;
+        int32_t originX = cell.x * cellSize * blockSize;
+        int32_t originY = cell.y * cellSize * blockSize;
+
+        usages.reserve(tiles.size());
+
+        for (size_t square = 0; square < coords.size(); square++)
+        {
+            CellCoord coord = coords[square];
+            int32_t x = originX + (coord.chunk_idx() / cellSize) * blockSize + coord.x();
+            int32_t y = originY + (coord.chunk_idx() % cellSize) * blockSize + coord.y();
+            uint64_t position = SpriteIndex::packPosition(x, y, coord.z());
+
+            for (uint32_t tile = tileOffsets[square]; tile < tileOffsets[square + 1]; tile++)
+            {
+                uint32_t tileIndex = static_cast<uint32_t>(tiles[tile]);
+                if (tileIndex >= tileIds.size())
+                    throw std::runtime_error("tile index out of the lotheader tile names");
+
+                usages.push_back(Usage{ tileIds[tileIndex], position });
+            }
+        }
+    }
+}
+
+SpriteIndex SpriteIndex::build(const MapManifest &manifest, size_t threads, const std::string &cellCacheDirectory)
+{
+    std::vector<std::vector<Usage>> cellUsages(manifest.cells.size());
+
+    Parallel::forEach(manifest.cells.size(), [&](size_t i)
+    {
+        const MapManifest::Cell &cell = manifest.cells[i];
+
+        if (!cellCacheDirectory.empty())
+        {
+            CellCache cache = CellCache::load(manifest, cell, cellCacheDirectory);
+            collectUsages(cell.position, cache.isB41(), cache.getCoords(), cache.getTileOffsets(), cache.getTiles(), cache.tileIds, cellUsages[i]);
+            return;
+        }
+
+        LotHeader header = LotHeader::read(manifest.lotheaderPath(cell), LotHeader::SECTION_TILE_NAMES);
+        Lotpack lotpack = Lotpack::read(manifest.lotpackPath(cell), &header);
+
+        const Lotpack::SquareTable &squares = lotpack.squares;
+        collectUsages(cell.position, header.isB41(), squares.coords, squares.tileOffsets, squares.tiles, header.tileIds, cellUsages[i]);
+    }, threads);
+
+    // counting pass over the dense registry ids, then every usage is placed in its sprite range
+    std::vector<uint64_t> counts(TileNameRegistry::global().size() + 1, 0);
+
+    for (const std::vector<Usage> &usages : cellUsages)
+    {
+        for (const Usage &usage : usages)
+        {
+            counts[usage.spriteId]++;
+        }
+    }
+
+    SpriteIndex index;
+    std::vector<uint64_t> fill(counts.size(), 0);
+    uint64_t total = 0;
+
+    for (uint32_t spriteId = 0; spriteId < counts.size(); spriteId++)
+    {
+        if (counts[spriteId] == 0)
+            continue;
+
+        index.spriteIds.push_back(spriteId);
+        fill[spriteId] = total;
+        total += counts[spriteId];
+        index.postingOffsets.push_back(total);
+    }
+
+    index.postings.resize(total);
+
+    for (std::vector<Usage> &usages : cellUsages)
+    {
+        for (const Usage &usage : usages)
+        {
+            index.postings[fill[usage.spriteId]++] = usage.position;
+        }
+
+        usages = {};
+    }
+
+    // a sprite can appear twice on a square, lists are sorted and deduplicated in place
+    std::vector<uint64_t> lengths(index.spriteIds.size());
+
+    Parallel::forEach(index.spriteIds.size(), [&](size_t sprite)
+    {
+        auto begin = index.postings.begin() + index.postingOffsets[sprite];
+        auto end = index.postings.begin() + index.postingOffsets[sprite + 1];
+
+        std::sort(begin, end);
+        lengths[sprite] = std::unique(begin, end) - begin;
+    }, threads);
+
+    uint64_t written = 0;
+
+    for (size_t sprite = 0; sprite < index.spriteIds.size(); sprite++)
+    {
+        auto begin = index.postings.begin() + index.postingOffsets[sprite];
+        std::move(begin, begin + lengths[sprite], index.postings.begin() + written);
+
+        index.postingOffsets[sprite] = written;
+        written += lengths[sprite];
+    }
+
+    index.postingOffsets.back() = written;
+    index.postings.resize(written);
+    index.postings.shrink_to_fit();
+
+    return index;
+}
+
+SpriteIndex SpriteIndex::build(const std::string &mapDirectory, size_t threads)
+{
+    return build(MapManifest::load(mapDirectory, threads), threads);
+}
+
+SpriteIndex SpriteIndex::read(BytesView buffer)
+{
+    BinaryCursor cursor(buffer);
+
+    if (cursor.readChars(4) != MAGIC)
+    {
+        throw std::runtime_error("Not a sprite index");
+    }
+
+    uint32_t version = cursor.readInt32();
+    if (version != VERSION)
+    {
+        throw std::runtime_error("Unsupported sprite index version: " + std::to_string(version));
+    }
+
+    uint32_t spritesCount = cursor.readInt32();
+
+    // ids of this process don't follow the file order, lists are decoded then reordered
+    std::vector<uint32_t> fileIds(spritesCount);
+    std::vector<uint64_t> fileOffsets(spritesCount + 1, 0);
+    std::vector<uint64_t> filePostings;
+
+    for (uint32_t sprite = 0; sprite < spritesCount; sprite++)
+    {
+        fileIds[sprite] = TileNameRegistry::global().intern(cursor.readStringWithLength());
+
+        uint32_t count = cursor.readInt32();
+        BytesView encoded = cursor.readBytesWithLength();
+
+        size_t offset = 0;
+        uint64_t position = 0;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            position += readVarint(encoded, offset);
+            filePostings.push_back(position);
+        }
+
+        fileOffsets[sprite + 1] = filePostings.size();
+    }
+
+    if (!cursor.eof())
+    {
+        throw std::runtime_error("sprite index has trailing data");
+    }
+
+    std::vector<uint32_t> order(spritesCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return fileIds[a] < fileIds[b]; });
+
+    SpriteIndex index;
+    index.spriteIds.reserve(spritesCount);
+    index.postingOffsets.reserve(spritesCount + 1);
+    index.postings.reserve(filePostings.size());
+
+    for (uint32_t sprite : order)
+    {
+        index.spriteIds.push_back(fileIds[sprite]);
+        index.postings.insert(index.postings.end(), filePostings.begin() + fileOffsets[sprite], filePostings.begin() + fileOffsets[sprite + 1]);
+        index.postingOffsets.push_back(index.postings.size());
+    }
+
+    return index;
+}
+
+SpriteIndex SpriteIndex::load(const std::string &path)
+{
+    MappedFile file = FileReader::map(path);
+
+    return read(file.view());
+}
+
+BytesBuffer SpriteIndex::write() const
+{
+    std::vector<BytesBuffer> encoded(spriteIds.size());
+    size_t size = 4 + 4 + 4;
+
+    for (size_t sprite = 0; sprite < spriteIds.size(); sprite++)
+    {
+        std::span<const uint64_t> list = std::span(postings).subspan(postingOffsets[sprite], postingOffsets[sprite + 1] - postingOffsets[sprite]);
+        uint64_t previous = 0;
+
+        encoded[sprite].reserve(list.size() * 2);
+
+        for (uint64_t position : list)
+        {
+            appendVarint(encoded[sprite], position - previous);
+            previous = position;
+        }
+
+        size += 4 + TileNameRegistry::global().name(spriteIds[sprite]).size() + 4 + 4 + encoded[sprite].size();
+    }
+
+    BinaryWriter writer(size);
+
+    writer.writeChars(MAGIC);
+    writer.writeInt32(VERSION);
+    writer.writeInt32(static_cast<int32_t>(spriteIds.size()));
+
+    for (size_t sprite = 0; sprite < spriteIds.size(); sprite++)
+    {
+        writer.writeStringWithLength(TileNameRegistry::global().name(spriteIds[sprite]));
+        writer.writeInt32(static_cast<int32_t>(postingOffsets[sprite + 1] - postingOffsets[sprite]));
+        writer.writeBytesWithLength(encoded[sprite]);
+    }
+
+    return writer.finish();
+}
+
+void SpriteIndex::save(const std::string &path) const
+{
+    FileReader::save(write(), path);
+}
+
+std::span<const uint64_t> SpriteIndex::postingsOf(uint32_t spriteId) const
+{
+    auto it = std::lower_bound(spriteIds.begin(), spriteIds.end(), spriteId);
+
+    if (it == spriteIds.end() || *it != spriteId)
+        return {};
+
+    size_t sprite = it - spriteIds.begin();
+
+    return std::span(postings).subspan(postingOffsets[sprite], postingOffsets[sprite + 1] - postingOffsets[sprite]);
+}
+
+std::span<const uint64_t> SpriteIndex::postingsOf(std::string_view spriteName) const
+{
+    uint32_t spriteId = TileNameRegistry::global().find(spriteName);
+
+    if (spriteId == UINT32_MAX)
+        return {};
+
+    return postingsOf(spriteId);
+}
+
+void SpriteIndex::intersect(std::span<const uint32_t> sprites, std::vector<uint64_t> &output) const
+{
+    output.clear();
+
+    if (sprites.empty())
+        return;
+
+    std::vector<std::span<const uint64_t>> lists;
+    lists.reserve(sprites.size());
+
+    for (uint32_t spriteId : sprites)
+    {
+        lists.push_back(postingsOf(spriteId));
+    }
+
+    // the shortest list bounds the result, the others are probed from it
+    std::sort(lists.begin(), lists.end(), [](const auto &a, const auto &b) { return a.size() < b.size(); });
+    output.assign(lists[0].begin(), lists[0].end());
+
+    for (size_t i = 1; i < lists.size() && !output.empty(); i++)
+    {
+        const uint64_t *cursor = lists[i].data();
+        const uint64_t *end = lists[i].data() + lists[i].size();
+        size_t kept = 0;
+
+        for (uint64_t position : output)
+        {
+            cursor = gallop(cursor, end, position);
+
+            if (cursor == end)
+                break;
+
+            if (*cursor == position)
+                output[kept++] = position;
+        }
+
+        output.resize(kept);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "files/map_manifest.h"
+#include "types.h"
+
+// Inverted index from sprite to the squares using it, over a whole map.
+// Every sprite (TileNameRegistry id) owns a sorted postings list of packed
+// world square positions, stored as flat arrays: sprite i owns the
+// [postingOffsets[i], postingOffsets[i + 1]) range of postings.
+//
+// file layout: "PZSI", version, sprites count, then per sprite its name,
+// postings count and the postings as delta encoded varints. Names are
+// stored instead of ids since registry ids only hold for one process.
+class SpriteIndex
+{
+public:
+    struct Position
+    {
+        int32_t x;
+        int32_t y;
+        int32_t z;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+    static constexpr std::string_view MAGIC = "PZSI";
+    static constexpr std::string_view EXTENSION = ".pzsi";
+
+private:
+    std::vector<uint32_t> spriteIds; // sorted
+    std::vector<uint64_t> postingOffsets{ 0 };
+    std::vector<uint64_t> postings;
+
+public:
+    SpriteIndex() = default;
+
+    // cells are decoded in parallel, threads = 0 uses every core; with a cell
+    // cache directory they are mapped from CellCache files instead
+    static SpriteIndex build(const MapManifest &manifest, size_t threads = 0, const std::string &cellCacheDirectory = "");
+    static SpriteIndex build(const std::string &mapDirectory, size_t threads = 0);
+
+    static SpriteIndex read(BytesView buffer);
+    static SpriteIndex load(const std::string &path);
+    BytesBuffer write() const;
+    void save(const std::string &path) const;
+
+    // world squares are packed in 24 bits for x and y and 16 bits for z,
+    // keys sort by x, then y, then z
+    static inline uint64_t packPosition(int32_t x, int32_t y, int32_t z)
+    {
+        return (static_cast<uint64_t>(x & 0xFFFFFF) << 40) | (static_cast<uint64_t>(y & 0xFFFFFF) << 16) | static_cast<uint16_t>(z + 0x8000);
+    }
+
+    static inline Position unpackPosition(uint64_t key)
+    {
+        return Position{ static_cast<int32_t>(key >> 40), static_cast<int32_t>((key >> 16) & 0xFFFFFF), static_cast<int32_t>(key & 0xFFFF) - 0x8000 };
+    }
+
+    inline size_t spritesCount() const { return spriteIds.size(); }
+    inline std::span<const uint32_t> getSpriteIds() const { return spriteIds; }
+
+    // empty when the sprite is not used
+    std::span<const uint64_t> postingsOf(uint32_t spriteId) const;
+    std::span<const uint64_t> postingsOf(std::string_view spriteName) const;
+
+    // squares using every one of the sprites, sorted
+    void intersect(std::span<const uint32_t> sprites, std::vector<uint64_t> &output) const;
+};
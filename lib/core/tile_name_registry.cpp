@@ -0,0 +1,85 @@
+#include "tile_name_registry.h"
+
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+TileNameRegistry &TileNameRegistry::global()
+{
+    static TileNameRegistry registry;
+    return registry;
+}
+
+uint32_t TileNameRegistry::insert(std::string_view name)
+{
+    auto it = idsByName.find(name);
+    if (it != idsByName.end())
+    {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(names.size());
+
+    // the key views the deque entry, which never moves
+    names.emplace_back(name);
+    idsByName.emplace(names.back(), id);
+
+    return id;
+}
+
+uint32_t TileNameRegistry::intern(std::string_view name)
+{
+    {
+        std::shared_lock lock(mutex);
+
+        auto it = idsByName.find(name);
+        if (it != idsByName.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock lock(mutex);
+    return insert(name);
+}
+
+void TileNameRegistry::intern(std::span<const std::string_view> tileNames, std::span<uint32_t> ids)
+{
+    if (tileNames.size() != ids.size())
+    {
+        throw std::invalid_argument("names and ids sizes differ");
+    }
+
+    std::unique_lock lock(mutex);
+
+    for (size_t i = 0; i < tileNames.size(); i++)
+    {
+        ids[i] = insert(tileNames[i]);
+    }
+}
+
+uint32_t TileNameRegistry::find(std::string_view name) const
+{
+    std::shared_lock lock(mutex);
+
+    auto it = idsByName.find(name);
+    return it != idsByName.end() ? it->second : UINT32_MAX;
+}
+
+std::string_view TileNameRegistry::name(uint32_t id) const
+{
+    std::shared_lock lock(mutex);
+
+    if (id >= names.size())
+    {
+        throw std::out_of_range("unknown tile id: " + std::to_string(id));
+    }
+
+    return names[id];
+}
+
+size_t TileNameRegistry::size() const
+{
+    std::shared_lock lock(mutex);
+    return names.size();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Process-wide table giving every sprite name a dense id, in first seen order.
+// Cells share most of their sprites, so they store ids and the names are
+// kept once here. Ids and the views returned by name() stay valid for the
+// whole process.
+class TileNameRegistry
+{
+private:
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> idsByName;
+    mutable std::shared_mutex mutex;
+
+    uint32_t insert(std::string_view name);
+
+public:
+    static TileNameRegistry &global();
+
+    uint32_t intern(std::string_view name);
+    void intern(std::span<const std::string_view> names, std::span<uint32_t> ids);
+
+    // returns UINT32_MAX when the name was never interned
+    uint32_t find(std::string_view name) const;
+    std::string_view name(uint32_t id) const;
+    size_t size() const;
+};
@@ -0,0 +1,365 @@
+#include "cell_cache.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/format.h>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "core/tile_name_registry.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
+#include "io/endian.h"
+#include "io/file_reader.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void writeHash(BinaryWriter &writer, const Fingerprint::Hash128 &hash)
+    {
+        writer.writeInt64(static_cast<int64_t>(hash.low));
+        writer.writeInt64(static_cast<int64_t>(hash.high));
+    }
+
+    Fingerprint::Hash128 readHash(BinaryCursor &cursor)
+    {
+        Fingerprint::Hash128 hash;
+        hash.low = static_cast<uint64_t>(cursor.readInt64());
+        hash.high = static_cast<uint64_t>(cursor.readInt64());
+        return hash;
+    }
+
+    template <typename T>
+    std::span<const T> mapArray(BytesView data, size_t &offset, size_t count)
+    {
+        std::span<const T> array(reinterpret_cast<const T *>(data.data() + offset), count);
+        offset += count * sizeof(T);
+        return array;
+    }
+
+    bool isRangeTable(std::span<const uint32_t> offsets, size_t total)
+    {
+        if (offsets.front() != 0 || offsets.back() != total)
+            return false;
+
+        for (size_t i = 1; i < offsets.size(); i++)
+        {
+            if (offsets[i] < offsets[i - 1])
+                return false;
+        }
+
+        return true;
+    }
+
+    // first square of every block, squares must be in block order
+    std::vector<uint32_t> blockOffsetsOf(const Lotpack &lotpack)
+    {
+        std::vector<uint32_t> offsets(lotpack.blocksCount + 1, 0);
+        uint32_t previous = 0;
+
+        for (CellCoord coord : lotpack.view().coords)
+        {
+            if (coord.chunk_idx() >= lotpack.blocksCount || coord.chunk_idx() < previous)
+                throw std::runtime_error("cell cache squares must be sorted by block");
+
+            previous = coord.chunk_idx();
+
+            offsets[coord.chunk_idx() + 1]++;
+        }
+
+        for (uint32_t block = 0; block < lotpack.blocksCount; block++)
+        {
+            offsets[block + 1] += offsets[block];
+        }
+
+        return offsets;
+    }
+}
+
+CellCache CellCache::open(const std::string &path)
+{
+    if constexpr (!Endian::isNativeLittle)
+    {
+        throw std::runtime_error("cell caches are only mapped on little-endian hosts");
+    }
+
+    CellCache cache;
+    cache.file = MappedFile(path, MappedFile::AccessHint::Random);
+
+    BytesView data = cache.file.view();
+    BinaryCursor cursor(data);
+
+    if (cursor.readChars(4) != MAGIC)
+    {
+        throw std::runtime_error("Invalid cell cache magic: " + path);
+    }
+
+    if (static_cast<uint32_t>(cursor.readInt32()) != VERSION)
+    {
+        throw std::runtime_error("Unsupported cell cache version: " + path);
+    }
+
+    cache.position.x = cursor.readInt32();
+    cache.position.y = cursor.readInt32();
+    cache.lotheaderHash = readHash(cursor);
+    cache.lotpackHash = readHash(cursor);
+    cache.flags = cursor.readInt32();
+    cache.lotpackVersion = cursor.readInt32();
+    cache.minLayer = cursor.readInt32();
+    cache.maxLayer = cursor.readInt32();
+    cache.blocksCount = cursor.readInt32();
+
+    uint32_t namesCount = cursor.readInt32();
+    uint32_t squaresCount = cursor.readInt32();
+    uint32_t tilesCount = cursor.readInt32();
+
+    size_t arraysSize = (static_cast<size_t>(cache.blocksCount) + 1 + 3 * static_cast<size_t>(squaresCount) + 1 + tilesCount) * 4;
+    if (arraysSize > cursor.remaining())
+    {
+        throw std::runtime_error("Truncated cell cache: " + path);
+    }
+
+    // every array has 4 bytes elements after a header of a multiple of 4 bytes, the mapping keeps them aligned
+    size_t offset = cursor.tell();
+    cache.blockOffsets = mapArray<uint32_t>(data, offset, cache.blocksCount + 1);
+    cache.coords = mapArray<CellCoord>(data, offset, squaresCount);
+    cache.roomIds = mapArray<uint32_t>(data, offset, squaresCount);
+    cache.tileOffsets = mapArray<uint32_t>(data, offset, squaresCount + 1);
+    cache.tiles = mapArray<int32_t>(data, offset, tilesCount);
+
+    // ranges are checked so no view can leave the mapping, room ids are opaque like in the lotpack
+    if (!isRangeTable(cache.blockOffsets, squaresCount) || !isRangeTable(cache.tileOffsets, tilesCount))
+    {
+        throw std::runtime_error("Corrupted cell cache ranges: " + path);
+    }
+
+    // tiles index tileIds, a corrupted value must not reach a lookup
+    for (int32_t tile : cache.tiles)
+    {
+        if (static_cast<uint32_t>(tile) >= namesCount)
+            throw std::runtime_error("Corrupted cell cache tiles: " + path);
+    }
+
+    for (uint32_t block = 0; block < cache.blocksCount; block++)
+    {
+        for (uint32_t square = cache.blockOffsets[block]; square < cache.blockOffsets[block + 1]; square++)
+        {
+            if (cache.coords[square].chunk_idx() != block)
+                throw std::runtime_error("Corrupted cell cache coords: " + path);
+        }
+    }
+
+    cursor.seek(offset);
+
+    std::vector<std::string_view> names(namesCount);
+    for (std::string_view &name : names)
+    {
+        name = cursor.readStringWithLength();
+    }
+
+    if (!cursor.eof())
+    {
+        throw std::runtime_error("Trailing data in cell cache: " + path);
+    }
+
+    cache.tileIds.resize(namesCount);
+    TileNameRegistry::global().intern(names, cache.tileIds);
+
+    return cache;
+}
+
+size_t CellCache::serializedSize(const LotHeader &header, const Lotpack &lotpack)
+{
+    Lotpack::SquareView squares = lotpack.view();
+    size_t size = HEADER_SIZE + (static_cast<size_t>(lotpack.blocksCount) + 1 + 3 * squares.size() + 1 + squares.tiles.size()) * 4;
+
+    for (size_t tile = 0; tile < header.tileIds.size(); tile++)
+    {
+        size += 4 + header.tileName(tile).size();
+    }
+
+    return size;
+}
+
+BytesBuffer CellCache::write(const LotHeader &header, const Lotpack &lotpack, const Fingerprint::Hash128 &lotheaderHash, const Fingerprint::Hash128 &lotpackHash)
+{
+    if (lotpack.isLazy() && !lotpack.isMapped())
+    {
+        throw std::runtime_error("cell caches need a fully decoded lotpack");
+    }
+
+    if (!header.hasSections(LotHeader::SECTION_TILE_NAMES))
+    {
+        throw std::runtime_error("cell caches need the lotheader tile names");
+    }
+
+    Lotpack::SquareView squares = lotpack.view();
+    std::vector<uint32_t> blockOffsets = blockOffsetsOf(lotpack);
+
+    BinaryWriter writer(serializedSize(header, lotpack));
+
+    writer.writeChars(MAGIC);
+    writer.writeInt32(VERSION);
+    writer.writeInt32(header.position.x);
+    writer.writeInt32(header.position.y);
+    writeHash(writer, lotheaderHash);
+    writeHash(writer, lotpackHash);
+    writer.writeInt32(header.isB41() ? FLAG_B41 : 0);
+    writer.writeInt32(lotpack.version);
+    writer.writeInt32(header.minLayer);
+    writer.writeInt32(header.maxLayer);
+    writer.writeInt32(lotpack.blocksCount);
+    writer.writeInt32(static_cast<int32_t>(header.tileIds.size()));
+    writer.writeInt32(static_cast<int32_t>(squares.size()));
+    writer.writeInt32(static_cast<int32_t>(squares.tiles.size()));
+
+    writer.writeInt32Array(std::span(blockOffsets));
+    writer.writeInt32Array(squares.coords);
+    writer.writeInt32Array(squares.roomIds);
+    writer.writeInt32Array(squares.tileOffsets);
+    writer.writeInt32Array(squares.tiles);
+
+    for (size_t tile = 0; tile < header.tileIds.size(); tile++)
+    {
+        writer.writeStringWithLength(header.tileName(tile));
+    }
+
+    return writer.finish();
+}
+
+std::string CellCache::cachePath(const std::string &cacheDirectory, Vector2i position, const Fingerprint::Hash128 &lotheaderHash, const Fingerprint::Hash128 &lotpackHash)
+{
+    uint64_t hashes[] = { lotheaderHash.low, lotheaderHash.high, lotpackHash.low, lotpackHash.high };
+    uint64_t version = Fingerprint::hash64(BytesView(reinterpret_cast<const uint8_t *>(hashes), sizeof(hashes)));
+
+    return fmt::format("{}/{}_{}_{:016x}{}", cacheDirectory, position.x, position.y, version, EXTENSION);
+}
+
+std::string CellCache::defaultDirectory(const std::string &mapDirectory)
+{
+    fs::path root;
+
+#ifdef _WIN32
+    const char *localAppData = std::getenv("LOCALAPPDATA");
+    if (localAppData != nullptr && *localAppData != '\0')
+        root = localAppData;
+#else
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    const char *home = std::getenv("HOME");
+    if (cacheHome != nullptr && *cacheHome != '\0')
+        root = cacheHome;
+    else if (home != nullptr && *home != '\0')
+        root = fs::path(home) / ".cache";
+#endif
+
+    if (root.empty())
+        root = fs::temp_directory_path();
+
+    // maps of different installs share a name, the path hash keeps their caches apart
+    fs::path directory = fs::path(mapDirectory).lexically_normal();
+    if (!directory.has_filename())
+        directory = directory.parent_path();
+
+    std::string path = directory.string();
+    uint64_t pathHash = Fingerprint::hash64(BytesView(reinterpret_cast<const uint8_t *>(path.data()), path.size()));
+
+    return (root / "pz-map-generator" / "cells" / fmt::format("{}_{:08x}", directory.filename().string(), pathHash & 0xFFFFFFFF)).string();
+}
+
+bool CellCache::isWritableDirectory(const std::string &cacheDirectory)
+{
+    std::string probePath = fmt::format("{}/.probe.{:08x}.tmp", cacheDirectory, std::random_device()());
+    std::error_code error;
+
+    try
+    {
+        fs::create_directories(cacheDirectory);
+        FileReader::save(BytesBuffer(), probePath);
+    }
+    catch (const std::exception &)
+    {
+        fs::remove(probePath, error);
+        return false;
+    }
+
+    fs::remove(probePath, error);
+    return true;
+}
+
+CellCache CellCache::load(const MapManifest &manifest, const MapManifest::Cell &cell, const std::string &cacheDirectory)
+{
+    std::string path = cachePath(cacheDirectory, cell);
+
+    if (fs::exists(path))
+    {
+        // an unreadable cache is rebuilt like a stale one
+        try
+        {
+            CellCache cache = open(path);
+
+            if (cache.matches(cell))
+                return cache;
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+    }
+
+    LotHeader header = LotHeader::read(manifest.lotheaderPath(cell), LotHeader::SECTION_TILE_NAMES);
+    Lotpack lotpack = Lotpack::read(manifest.lotpackPath(cell), &header);
+
+    // Every version of a cell has its own file name, so a cache is never
+    // replaced or removed here while it may be mapped: Windows refuses both.
+    // The temporary name is unique per writer, concurrent builds of the same
+    // version each rename a complete file.
+    std::string temporaryPath = fmt::format("{}.{:08x}.tmp", path, std::random_device()());
+    fs::create_directories(cacheDirectory);
+    FileReader::save(write(header, lotpack, cell.lotheader.hash, cell.lotpack.hash), temporaryPath);
+
+    std::error_code error;
+    fs::rename(temporaryPath, path, error);
+
+    if (error)
+    {
+        fs::remove(temporaryPath, error);
+
+        if (!fs::exists(path))
+            throw std::runtime_error("Failed to save cell cache: " + path);
+    }
+
+    removeStaleVersions(cacheDirectory, cell.position, path);
+
+    return open(path);
+}
+
+void CellCache::removeStaleVersions(const std::string &cacheDirectory, Vector2i position, const std::string &currentPath)
+{
+    std::string prefix = fmt::format("{}_{}_", position.x, position.y);
+    std::string current = fs::path(currentPath).filename().string();
+    std::error_code error;
+
+    // best effort, a version still mapped by another process is removed by a later load
+    for (const fs::directory_entry &entry : fs::directory_iterator(cacheDirectory, error))
+    {
+        std::string name = entry.path().filename().string();
+
+        if (name.starts_with(prefix) && name.ends_with(EXTENSION) && name != current)
+        {
+            fs::remove(entry.path(), error);
+        }
+    }
+}
+
+Lotpack CellCache::mapLotpack(std::shared_ptr<const CellCache> cache, const LotHeader *header, bool lazy)
+{
+    Lotpack::SquareView view{ cache->coords, cache->roomIds, cache->tileOffsets, cache->tiles };
+    std::span<const uint32_t> blockOffsets = cache->blockOffsets;
+
+    Lotpack lotpack = Lotpack::map(view, blockOffsets, cache, header, lazy);
+    lotpack.magic = cache->isB41() ? "" : std::string(constants::MAGIC_LOTPACK);
+    lotpack.version = cache->lotpackVersion;
+
+    return lotpack;
+}
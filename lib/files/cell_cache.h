@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "core/cell_coord.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "files/map_manifest.h"
+#include "io/mapped_file.h"
+#include "math/fingerprint.h"
+#include "math/vector2i.h"
+#include "types.h"
+
+// Decoded squares of one cell, stored so that opening it is a mapping and a
+// header check: the arrays are used in place, nothing is decoded.
+//
+// layout: "PZCC", version, position, lotheader and lotpack hashes, flags,
+// lotpack version, min and max layers, blocks, tile names, squares and tiles
+// counts, then the little-endian arrays of Lotpack::SquareTable preceded by
+// the first square of every block (blocks count + 1 entries), then the tile
+// names. Tiles keep their lotheader indices and the names are interned on
+// open, registry ids only hold for one process.
+class CellCache
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t FLAG_B41 = 1;
+    static constexpr size_t HEADER_SIZE = 4 + 4 + 2 * 4 + 2 * 16 + 4 * 4 + 4 * 4;
+
+    static constexpr std::string_view MAGIC = "PZCC";
+    static constexpr std::string_view EXTENSION = ".pzcc";
+
+    static_assert(sizeof(CellCoord) == 4, "coords are mapped as 32 bits words");
+
+    Vector2i position{ 0, 0 };
+    Fingerprint::Hash128 lotheaderHash;
+    Fingerprint::Hash128 lotpackHash;
+    uint32_t flags = 0;
+    uint32_t lotpackVersion = 0;
+    int32_t minLayer = 0;
+    int32_t maxLayer = 0;
+    uint32_t blocksCount = 0;
+
+    std::vector<uint32_t> tileIds; // TileNameRegistry ids, indexed by the tiles values
+
+private:
+    MappedFile file;
+
+    std::span<const uint32_t> blockOffsets;
+    std::span<const CellCoord> coords;
+    std::span<const uint32_t> roomIds;
+    std::span<const uint32_t> tileOffsets;
+    std::span<const int32_t> tiles;
+
+public:
+    CellCache() = default;
+
+    // checks the header, the offsets tables, the block of every square and the
+    // tile names index of every tile, throws if the file is not a valid cache
+    static CellCache open(const std::string &path);
+
+    // lotpack must be fully decoded, header needs its tile names
+    static size_t serializedSize(const LotHeader &header, const Lotpack &lotpack);
+    static BytesBuffer write(const LotHeader &header, const Lotpack &lotpack, const Fingerprint::Hash128 &lotheaderHash, const Fingerprint::Hash128 &lotpackHash);
+
+    // one file name per version of the cell, derived from both map file hashes
+    static std::string cachePath(const std::string &cacheDirectory, Vector2i position, const Fingerprint::Hash128 &lotheaderHash, const Fingerprint::Hash128 &lotpackHash);
+    static inline std::string cachePath(const std::string &cacheDirectory, const MapManifest::Cell &cell)
+    {
+        return cachePath(cacheDirectory, cell.position, cell.lotheader.hash, cell.lotpack.hash);
+    }
+
+    // per-user cache location of a map directory, never next to the game files
+    // which are usually read-only
+    static std::string defaultDirectory(const std::string &mapDirectory);
+
+    // creates the directory and a probe file in it, false when caches can't be saved there
+    static bool isWritableDirectory(const std::string &cacheDirectory);
+
+    // cache of a manifest cell, decoded from the map files and saved again when missing or stale
+    static CellCache load(const MapManifest &manifest, const MapManifest::Cell &cell, const std::string &cacheDirectory);
+
+    inline bool isB41() const { return (flags & FLAG_B41) != 0; }
+    inline bool matches(const MapManifest::Cell &cell) const { return cell.lotheader.hash == lotheaderHash && cell.lotpack.hash == lotpackHash; }
+
+    inline size_t squaresCount() const { return coords.size(); }
+    inline std::span<const CellCoord> getCoords() const { return coords; }
+    inline std::span<const uint32_t> getRoomIds() const { return roomIds; }
+    inline std::span<const uint32_t> getTileOffsets() const { return tileOffsets; }
+    inline std::span<const int32_t> getTiles() const { return tiles; }
+
+    // [first, last) squares of the block
+    inline std::pair<uint32_t, uint32_t> blockSquares(uint32_t blockIndex) const { return { blockOffsets[blockIndex], blockOffsets[blockIndex + 1] }; }
+
+    inline std::span<const int32_t> squareTiles(size_t square) const
+    {
+        return tiles.subspan(tileOffsets[square], tileOffsets[square + 1] - tileOffsets[square]);
+    }
+
+    // lotpack of that header viewing the mapped arrays, it shares the cache so
+    // the mapping outlives it; a lazy one only visits the blocks loaded so far
+    static Lotpack mapLotpack(std::shared_ptr<const CellCache> cache, const LotHeader *header, bool lazy = false);
+
+private:
+    static void removeStaleVersions(const std::string &cacheDirectory, Vector2i position, const std::string &currentPath);
+};
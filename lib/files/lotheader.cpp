@@ -1,167 +1,468 @@
-#include <regex>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
 
 #include "constants.h"
+#include "core/tile_name_registry.h"
 #include "exceptions.h"
-#include "io/binary_reader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
 #include "io/file_reader.h"
 #include "lotheader.h"
 #include "math/vector2i.h"
 #include "types.h"
 
-LotHeader LotHeader::read(const std::string &filename)
+LotHeader LotHeader::read(const std::string &filename, uint32_t sections)
 {
     Vector2i cellPosition = getPositionFromFilename(filename);
-    BytesBuffer buffer = FileReader::read(filename);
+    MappedFile file = FileReader::map(filename);
 
-    return read(buffer, cellPosition);
+    return read(file.view(), cellPosition, sections);
 }
 
-LotHeader LotHeader::read(const BytesBuffer &buffer, Vector2i position)
+LotHeader LotHeader::read(BytesView buffer, Vector2i position, uint32_t sections)
 {
     LotHeader header = LotHeader();
-    size_t offset = 0;
 
     header.position = position;
-    header.magic = BinaryReader::read_n_chars(buffer, 4, offset);
-    header.version = BinaryReader::readInt32(buffer, offset);
-    header.tileNames = LotHeader::readTileNames(buffer, offset);
-    header.width = BinaryReader::readInt32(buffer, offset);
-    header.height = BinaryReader::readInt32(buffer, offset);
-    header.minLayer = BinaryReader::readInt32(buffer, offset);
-    header.maxLayer = BinaryReader::readInt32(buffer, offset) + 1;
-    header.rooms = LotHeader::readRooms(buffer, offset);
-    header.buildings = LotHeader::readBuildings(buffer, offset);
-    header.spawns = BinaryReader::readExact(buffer, constants::BLOCKS_PER_CELL, offset);
+    header.load(buffer, sections);
 
-    if (offset != buffer.size())
+    return header;
+}
+
+void LotHeader::load(BytesView buffer, uint32_t sections)
+{
+    if (!sectionIndex)
     {
-        throw Exceptions::FileEndNotReached(offset, buffer.size());
+        sectionIndex = indexSections(buffer);
     }
 
+    if (!sectionIndex)
+    {
+        // malformed file: the checked parser reports where it breaks
+        Vector2i cellPosition = position;
+        *this = parse<BinaryCursor>(buffer, cellPosition);
+        return;
+    }
+
+    parseSections(buffer, sections);
+}
+
+bool LotHeader::validate(BytesView buffer)
+{
+    return indexSections(buffer).has_value();
+}
+
+std::optional<LotHeader::SectionIndex> LotHeader::indexSections(BytesView buffer)
+{
+    try
+    {
+        BinaryCursor cursor(buffer);
+        SectionIndex index{};
+
+        // magic + version, then the same walk as parse() without materializing anything
+        bool b41 = !hasMagic(buffer);
+        cursor.skip(b41 ? 4 : 8);
+
+        index.tileNames = cursor.tell();
+        uint32_t tilesCount = cursor.readInt32();
+        for (uint32_t i = 0; i < tilesCount; i++)
+        {
+            cursor.readLine();
+        }
+
+        if (b41)
+            cursor.skip(1);
+
+        // width, height, then min and max layers or the B41 levels count
+        index.dimensions = cursor.tell();
+        cursor.skip(b41 ? 12 : 16);
+
+        index.rooms = cursor.tell();
+        uint32_t roomsCount = cursor.readInt32();
+        for (uint32_t i = 0; i < roomsCount; i++)
+        {
+            cursor.readLine();
+            cursor.skip(4);
+
+            uint32_t rectanglesCount = cursor.readInt32();
+            cursor.skip(rectanglesCount * sizeof(Rectangle));
+
+            uint32_t objectsCount = cursor.readInt32();
+            cursor.skip(objectsCount * sizeof(RoomObject));
+        }
+
+        index.buildings = cursor.tell();
+        uint32_t buildingsCount = cursor.readInt32();
+        for (uint32_t i = 0; i < buildingsCount; i++)
+        {
+            uint32_t buildingRoomsCount = cursor.readInt32();
+            cursor.skip(buildingRoomsCount * sizeof(uint32_t));
+        }
+
+        index.spawns = cursor.tell();
+        cursor.skip(b41 ? constants::B41_BLOCKS_PER_CELL : constants::BLOCKS_PER_CELL);
+
+        if (!cursor.eof())
+            return std::nullopt;
+
+        return index;
+    }
+    catch (const std::runtime_error &)
+    {
+        return std::nullopt;
+    }
+}
+
+// buffer has been indexed, every section can be read unchecked
+void LotHeader::parseSections(BytesView buffer, uint32_t sections)
+{
+    const SectionIndex &index = *sectionIndex;
+    UncheckedBinaryCursor cursor(buffer);
+
+    readPreamble(cursor, !hasMagic(buffer));
+
+    cursor.seek(index.dimensions);
+    readDimensions(cursor);
+
+    uint32_t missing = sections & ~loadedSections;
+
+    if (missing & SECTION_TILE_NAMES)
+    {
+        cursor.seek(index.tileNames);
+        tileIds = LotHeader::readTileNames(cursor);
+    }
+
+    if (missing & SECTION_ROOMS)
+    {
+        cursor.seek(index.rooms);
+        LotHeader::readRooms(cursor, rooms);
+    }
+
+    if (missing & SECTION_BUILDINGS)
+    {
+        cursor.seek(index.buildings);
+        LotHeader::readBuildings(cursor, rooms);
+    }
+
+    if (missing & SECTION_SPAWNS)
+    {
+        cursor.seek(index.spawns);
+        spawns = LotHeader::readSpawns(cursor, cellSizeInBlocks() * cellSizeInBlocks());
+    }
+
+    loadedSections |= missing;
+}
+
+template <typename Cursor>
+LotHeader LotHeader::parse(BytesView buffer, Vector2i position)
+{
+    LotHeader header = LotHeader();
+    Cursor cursor(buffer);
+
+    header.position = position;
+    header.readPreamble(cursor, !hasMagic(buffer));
+    header.tileIds = LotHeader::readTileNames(cursor);
+
+    if (header.isB41())
+        cursor.skip(1);
+
+    header.readDimensions(cursor);
+    LotHeader::readRooms(cursor, header.rooms);
+    LotHeader::readBuildings(cursor, header.rooms);
+
+    header.spawns = LotHeader::readSpawns(cursor, header.cellSizeInBlocks() * header.cellSizeInBlocks());
+
+    if (!cursor.eof())
+    {
+        throw Exceptions::FileEndNotReached(cursor.tell(), cursor.size());
+    }
+
+    header.loadedSections = SECTION_ALL;
+
     return header;
 }
 
-std::vector<std::string> LotHeader::readTileNames(const BytesBuffer &buffer, size_t &offset)
+bool LotHeader::hasMagic(BytesView buffer)
 {
-    uint32_t tilesCount = BinaryReader::readInt32(buffer, offset);
+    return buffer.size() >= 4 && std::memcmp(buffer.data(), constants::MAGIC_LOTHEADER.data(), 4) == 0;
+}
 
-    std::vector<std::string> tilenames(tilesCount);
+template <typename Cursor>
+void LotHeader::readPreamble(Cursor &cursor, bool b41)
+{
+    magic = b41 ? "" : cursor.readChars(4);
+    version = cursor.readInt32();
+}
+
+template <typename Cursor>
+void LotHeader::readDimensions(Cursor &cursor)
+{
+    width = cursor.readInt32();
+    height = cursor.readInt32();
+
+    if (isB41())
+    {
+        minLayer = 0;
+        maxLayer = cursor.readInt32();
+        return;
+    }
+
+    minLayer = cursor.readInt32();
+    maxLayer = cursor.readInt32() + 1;
+}
+
+template <typename Cursor>
+std::vector<uint32_t> LotHeader::readTileNames(Cursor &cursor)
+{
+    uint32_t tilesCount = cursor.readInt32();
+
+    // views into the buffer, interned in one pass
+    std::vector<std::string_view> tilenames(tilesCount);
 
     for (uint32_t i = 0; i < tilesCount; i++)
     {
-        tilenames[i] = BinaryReader::readLineTrimmed(buffer, offset);
+        tilenames[i] = cursor.readLine();
     }
 
-    return tilenames;
+    std::vector<uint32_t> tileIds(tilesCount);
+    TileNameRegistry::global().intern(tilenames, tileIds);
+
+    return tileIds;
 }
 
-std::vector<LotHeader::Room> LotHeader::readRooms(const BytesBuffer &buffer, size_t &offset)
+template <typename Cursor>
+void LotHeader::readRooms(Cursor &cursor, RoomTable &rooms)
 {
-    uint32_t roomsCount = BinaryReader::readInt32(buffer, offset);
+    uint32_t roomsCount = cursor.readInt32();
 
-    std::vector<Room> rooms(roomsCount);
+    rooms.layers.resize(roomsCount);
+    rooms.areas.resize(roomsCount);
+    rooms.nameOffsets.resize(roomsCount + 1);
+    rooms.rectangleOffsets.resize(roomsCount + 1);
+    rooms.objectOffsets.resize(roomsCount + 1);
 
     for (uint32_t i = 0; i < roomsCount; i++)
     {
-        Room room = Room();
+        rooms.names += cursor.readLine();
+        rooms.nameOffsets[i + 1] = static_cast<uint32_t>(rooms.names.size());
+        rooms.layers[i] = cursor.readInt32();
+
+        uint32_t rectanglesCount = cursor.readInt32();
+        size_t firstRectangle = rooms.rectangles.size();
 
-        room.id = i;
-        room.name = BinaryReader::readLineTrimmed(buffer, offset);
-        room.layer = BinaryReader::readInt32(buffer, offset);
-        room.rectangles = LotHeader::readRectangles(buffer, offset);
-        room.roomObjects = LotHeader::readRoomObjects(buffer, offset);
-        room.area = 0;
+        rooms.rectangles.resize(firstRectangle + rectanglesCount);
+        cursor.readInt32Array(std::span(rooms.rectangles).subspan(firstRectangle));
+        rooms.rectangleOffsets[i + 1] = static_cast<uint32_t>(rooms.rectangles.size());
 
-        for (const Rectangle &rect : room.rectangles)
+        uint32_t objectsCount = cursor.readInt32();
+        size_t firstObject = rooms.roomObjects.size();
+
+        rooms.roomObjects.resize(firstObject + objectsCount);
+        cursor.readInt32Array(std::span(rooms.roomObjects).subspan(firstObject));
+        rooms.objectOffsets[i + 1] = static_cast<uint32_t>(rooms.roomObjects.size());
+
+        uint32_t area = 0;
+        for (const Rectangle &rect : rooms.roomRectangles(i))
         {
-            room.area += rect.width * rect.heigth;
+            area += rect.width * rect.heigth;
         }
 
-        rooms[i] = room;
+        rooms.areas[i] = area;
     }
-
-    return rooms;
 }
 
-std::vector<LotHeader::Rectangle> LotHeader::readRectangles(const BytesBuffer &buffer, size_t &offset)
+template <typename Cursor>
+void LotHeader::readBuildings(Cursor &cursor, RoomTable &rooms)
 {
-    uint32_t rectanglesCount = BinaryReader::readInt32(buffer, offset);
+    uint32_t buildingsCount = cursor.readInt32();
 
-    std::vector<Rectangle> rectangles(rectanglesCount);
+    rooms.buildingRoomOffsets.resize(buildingsCount + 1);
 
-    for (uint32_t i = 0; i < rectanglesCount; i++)
+    for (uint32_t i = 0; i < buildingsCount; i++)
     {
-        Rectangle rect = Rectangle();
+        uint32_t roomsCount = cursor.readInt32();
+        size_t firstRoom = rooms.buildingRoomIds.size();
 
-        rect.x = BinaryReader::readInt32(buffer, offset);
-        rect.y = BinaryReader::readInt32(buffer, offset);
-        rect.width = BinaryReader::readInt32(buffer, offset);
-        rect.heigth = BinaryReader::readInt32(buffer, offset);
+        rooms.buildingRoomIds.resize(firstRoom + roomsCount);
+        cursor.readInt32Array(std::span(rooms.buildingRoomIds).subspan(firstRoom));
+        rooms.buildingRoomOffsets[i + 1] = static_cast<uint32_t>(rooms.buildingRoomIds.size());
+    }
+}
 
-        rectangles[i] = rect;
+size_t LotHeader::serializedSize() const
+{
+    size_t size = magic.size() + 4 + 4;
+
+    for (size_t i = 0; i < tileIds.size(); i++)
+    {
+        size += tileName(i).size() + 1;
     }
 
-    return rectangles;
+    // B41: 0 byte, width, height and levels; B42: width, height, min and max layers
+    size += isB41() ? 1 + 3 * 4 : 4 * 4;
+    size += 4;
+
+    // per room: name line, layer, rectangles count and objects count
+    size += rooms.names.size() + rooms.roomsCount() * (1 + 4 + 4 + 4);
+    size += rooms.rectangles.size() * sizeof(Rectangle);
+    size += rooms.roomObjects.size() * sizeof(RoomObject);
+
+    size += 4 + rooms.buildingsCount() * 4 + rooms.buildingRoomIds.size() * sizeof(uint32_t);
+
+    return size + spawns.size();
 }
 
-std::vector<LotHeader::RoomObject> LotHeader::readRoomObjects(const BytesBuffer &buffer, size_t &offset)
+BytesBuffer LotHeader::write() const
 {
-    uint32_t objectsCount = BinaryReader::readInt32(buffer, offset);
+    if (!hasSections(SECTION_ALL))
+    {
+        throw std::runtime_error("lotheader sections not loaded, can't be written");
+    }
+
+    BinaryWriter writer(serializedSize());
+
+    writer.writeChars(magic);
+    writer.writeInt32(version);
+    writer.writeInt32(static_cast<int32_t>(tileIds.size()));
+
+    for (size_t i = 0; i < tileIds.size(); i++)
+    {
+        writer.writeLine(tileName(i));
+    }
+
+    if (isB41())
+    {
+        const uint8_t separator = 0;
+        writer.writeBytes(BytesView(&separator, 1));
+        writer.writeInt32(width);
+        writer.writeInt32(height);
+        writer.writeInt32(maxLayer);
+    }
+    else
+    {
+        writer.writeInt32(width);
+        writer.writeInt32(height);
+        writer.writeInt32(minLayer);
+        writer.writeInt32(maxLayer - 1);
+    }
 
-    std::vector<RoomObject> roomObjects(objectsCount);
+    writer.writeInt32(static_cast<int32_t>(rooms.roomsCount()));
 
-    for (uint32_t i = 0; i < objectsCount; i++)
+    for (size_t i = 0; i < rooms.roomsCount(); i++)
     {
-        RoomObject roomObject = RoomObject();
+        std::span<const Rectangle> rectangles = rooms.roomRectangles(i);
+        std::span<const RoomObject> roomObjects = rooms.roomObjectsOf(i);
+
+        writer.writeLine(rooms.roomName(i));
+        writer.writeInt32(rooms.layers[i]);
+        writer.writeInt32(static_cast<int32_t>(rectangles.size()));
+        writer.writeInt32Array(rectangles);
+        writer.writeInt32(static_cast<int32_t>(roomObjects.size()));
+        writer.writeInt32Array(roomObjects);
+    }
 
-        roomObject.room_type = BinaryReader::readInt32(buffer, offset);
-        roomObject.x = BinaryReader::readInt32(buffer, offset);
-        roomObject.y = BinaryReader::readInt32(buffer, offset);
+    writer.writeInt32(static_cast<int32_t>(rooms.buildingsCount()));
 
-        roomObjects[i] = roomObject;
+    for (size_t i = 0; i < rooms.buildingsCount(); i++)
+    {
+        std::span<const uint32_t> roomIds = rooms.buildingRooms(i);
+
+        writer.writeInt32(static_cast<int32_t>(roomIds.size()));
+        writer.writeInt32Array(roomIds);
     }
 
-    return roomObjects;
+    writer.writeBytes(spawns);
+
+    return writer.finish();
 }
 
-std::vector<LotHeader::Building> LotHeader::readBuildings(const BytesBuffer &buffer, size_t &offset)
+void LotHeader::save(const std::string &filename) const
 {
-    uint32_t buildingsCount = BinaryReader::readInt32(buffer, offset);
+    FileReader::save(write(), filename);
+}
 
-    std::vector<Building> buildings(buildingsCount);
+std::string_view LotHeader::tileName(size_t index) const
+{
+    return TileNameRegistry::global().name(tileIds[index]);
+}
 
-    for (uint32_t i = 0; i < buildingsCount; i++)
+void LotHeader::toGlobalTileIds(std::span<const int32_t> tiles, std::span<uint32_t> output) const
+{
+    if (tiles.size() != output.size())
+    {
+        throw std::invalid_argument("tiles and output sizes differ");
+    }
+
+    for (size_t i = 0; i < tiles.size(); i++)
     {
-        uint32_t roomsCount = BinaryReader::readInt32(buffer, offset);
+        output[i] = tileIds.at(static_cast<uint32_t>(tiles[i]));
+    }
+}
 
-        Building building = Building();
+template <typename Cursor>
+std::vector<uint8_t> LotHeader::readSpawns(Cursor &cursor, size_t chunksCount)
+{
+    BytesView spawns = cursor.readExact(chunksCount);
 
-        building.id = i;
-        building.room_ids = std::vector<uint32_t>(roomsCount);
+    return std::vector<uint8_t>(spawns.begin(), spawns.end());
+}
 
-        for (uint32_t j = 0; j < roomsCount; j++)
-        {
-            building.room_ids[j] = BinaryReader::readInt32(buffer, offset);
-        }
+uint8_t LotHeader::spawnDensity(int chunkX, int chunkY) const
+{
+    if (chunkX < 0 || chunkY < 0 || chunkX >= cellSizeInBlocks() || chunkY >= cellSizeInBlocks())
+    {
+        throw std::out_of_range("chunk out of cell bounds");
+    }
 
-        buildings[i] = building;
+    if (!hasSections(SECTION_SPAWNS))
+    {
+        throw std::runtime_error("spawns section not loaded");
     }
 
-    return buildings;
+    return spawns[chunkX * cellSizeInBlocks() + chunkY];
 }
 
-BytesBuffer LotHeader::readSpawns(const BytesBuffer &buffer, size_t &offset)
+std::optional<Vector2i> LotHeader::parsePositionFromFilename(std::string_view filename)
 {
-    throw Exceptions::NotImplemented();
+    size_t separator = filename.find_last_of("/\\");
+    if (separator != std::string_view::npos)
+        filename.remove_prefix(separator + 1);
+
+    if (!filename.ends_with(constants::LOTHEADER_EXT))
+        return std::nullopt;
+
+    filename.remove_suffix(constants::LOTHEADER_EXT.size());
+
+    size_t underscore = filename.rfind('_');
+    if (underscore == std::string_view::npos || underscore + 1 >= filename.size() || filename[underscore + 1] < '0' || filename[underscore + 1] > '9')
+        return std::nullopt;
+
+    // x is the run of digits right before the underscore
+    size_t start = underscore;
+    while (start > 0 && filename[start - 1] >= '0' && filename[start - 1] <= '9')
+        start--;
+
+    const char *end = filename.data() + filename.size();
+    Vector2i position{};
+
+    auto [xEnd, xError] = std::from_chars(filename.data() + start, filename.data() + underscore, position.x);
+    if (xError != std::errc() || xEnd != filename.data() + underscore)
+        return std::nullopt;
+
+    auto [yEnd, yError] = std::from_chars(filename.data() + underscore + 1, end, position.y);
+    if (yError != std::errc() || yEnd != end)
+        return std::nullopt;
+
+    return position;
 }
 
 Vector2i LotHeader::getPositionFromFilename(const std::string& filename)
 {
-    static const std::regex pattern(R"((\d+)_(\d+)\.lotheader)");
+    std::optional<Vector2i> position = parsePositionFromFilename(filename);
 
-    std::smatch match;
-    if (!std::regex_search(filename, match, pattern))
+    if (!position)
         throw std::runtime_error("Impossible d'extraire la position depuis : " + filename);
 
-    return { std::stoi(match[1]), std::stoi(match[2]) };
-}
\ No newline at end of file
+    return *position;
+}
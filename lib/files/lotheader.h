@@ -2,9 +2,14 @@
 
 #include <SFML/System/Vector2.hpp>
 #include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "constants.h"
+#include "io/binary_cursor.h"
 #include "math/vector2i.h"
 #include "types.h"
 
@@ -27,47 +32,134 @@ public:
         uint32_t y;
     };
 
-    struct Building
-    {
-        uint32_t id;
-        std::vector<uint32_t> room_ids;
-    };
+    // both are decoded with a single copy, their layout must match the file
+    static_assert(sizeof(Rectangle) == 4 * sizeof(uint32_t));
+    static_assert(sizeof(RoomObject) == 3 * sizeof(uint32_t));
 
-    struct Room
+    // Rooms and buildings of a cell stored as flat arrays: every room owns a
+    // [begin, end) range in the rectangles, objects and names arrays, every
+    // building a range in buildingRoomIds. Offsets arrays have count + 1 entries.
+    struct RoomTable
     {
-        uint32_t id;
-        std::string name;
-        uint32_t layer;
-        uint32_t area;
+        std::vector<uint32_t> layers;
+        std::vector<uint32_t> areas;
+        std::vector<uint32_t> nameOffsets{ 0 };
+        std::vector<uint32_t> rectangleOffsets{ 0 };
+        std::vector<uint32_t> objectOffsets{ 0 };
+
+        std::string names;
         std::vector<Rectangle> rectangles;
         std::vector<RoomObject> roomObjects;
+
+        std::vector<uint32_t> buildingRoomOffsets{ 0 };
+        std::vector<uint32_t> buildingRoomIds;
+
+        inline size_t roomsCount() const { return layers.size(); }
+        inline size_t buildingsCount() const { return buildingRoomOffsets.size() - 1; }
+
+        inline std::string_view roomName(size_t room) const
+        {
+            return std::string_view(names).substr(nameOffsets[room], nameOffsets[room + 1] - nameOffsets[room]);
+        }
+
+        inline std::span<const Rectangle> roomRectangles(size_t room) const
+        {
+            return std::span(rectangles).subspan(rectangleOffsets[room], rectangleOffsets[room + 1] - rectangleOffsets[room]);
+        }
+
+        inline std::span<const RoomObject> roomObjectsOf(size_t room) const
+        {
+            return std::span(roomObjects).subspan(objectOffsets[room], objectOffsets[room + 1] - objectOffsets[room]);
+        }
+
+        inline std::span<const uint32_t> buildingRooms(size_t building) const
+        {
+            return std::span(buildingRoomIds).subspan(buildingRoomOffsets[building], buildingRoomOffsets[building + 1] - buildingRoomOffsets[building]);
+        }
     };
 
-    std::string magic = "";
-    int32_t version = 0;
+    // Offsets of each section in the file, each one starts with its count.
+    struct SectionIndex
+    {
+        size_t tileNames;
+        size_t dimensions;
+        size_t rooms;
+        size_t buildings;
+        size_t spawns;
+    };
+
+    static constexpr uint32_t SECTION_TILE_NAMES = 1 << 0;
+    static constexpr uint32_t SECTION_ROOMS = 1 << 1;
+    static constexpr uint32_t SECTION_BUILDINGS = 1 << 2;
+    static constexpr uint32_t SECTION_SPAWNS = 1 << 3;
+    static constexpr uint32_t SECTION_ALL = SECTION_TILE_NAMES | SECTION_ROOMS | SECTION_BUILDINGS | SECTION_SPAWNS;
+
+    std::string magic = std::string(constants::MAGIC_LOTHEADER);
+    int32_t version = 1;
     int32_t width = 0;
     int32_t height = 0;
     int32_t maxLayer = 0;
     int32_t minLayer = 0;
     Vector2i position;
 
-    std::vector<std::string> tileNames;
-    std::vector<Room> rooms;
-    std::vector<Building> buildings;
-    std::vector<uint8_t> spawns;
+    std::vector<uint32_t> tileIds; // TileNameRegistry ids, indexed by the lotpack tile indices
+    RoomTable rooms;
+    std::vector<uint8_t> spawns; // zombie density per chunk, chunk index = chunkX * cellSizeInBlocks() + chunkY
+
+    uint32_t loadedSections = 0;
+    std::optional<SectionIndex> sectionIndex;
 
     LotHeader() = default;
 
-    static LotHeader read(const std::string &filename);
-    static LotHeader read(const BytesBuffer &buffer, Vector2i position);
+    // magic, version, dimensions and layers are always decoded, the other
+    // sections only when requested
+    static LotHeader read(const std::string &filename, uint32_t sections = SECTION_ALL);
+    static LotHeader read(BytesView buffer, Vector2i position, uint32_t sections = SECTION_ALL);
+    static bool validate(BytesView buffer);
+    static std::optional<SectionIndex> indexSections(BytesView buffer);
+
+    // B41 files have no magic: the tile names are followed by a 0 byte and a
+    // single levels count, cells are 30x30 chunks of 10x10 squares
+    inline bool isB41() const { return magic.empty(); }
+    inline int blockSizeInSquares() const { return isB41() ? constants::B41_BLOCK_SIZE_IN_SQUARE : constants::BLOCK_SIZE_IN_SQUARE; }
+    inline int cellSizeInBlocks() const { return isB41() ? constants::B41_CELL_SIZE_IN_BLOCKS : constants::CELL_SIZE_IN_BLOCKS; }
+
+    // decodes sections not loaded yet, buffer must be the one the header was read from
+    void load(BytesView buffer, uint32_t sections);
+    inline bool hasSections(uint32_t sections) const { return (loadedSections & sections) == sections; }
 
+    size_t serializedSize() const;
+    BytesBuffer write() const;
+    void save(const std::string &filename) const;
+
+    std::string_view tileName(size_t index) const;
+
+    // chunk coordinates are local to the cell
+    uint8_t spawnDensity(int chunkX, int chunkY) const;
+
+    // translates lotpack tile indices into registry ids
+    void toGlobalTileIds(std::span<const int32_t> tiles, std::span<uint32_t> output) const;
+
+    // "x_y.lotheader", directories in front of the name are ignored
+    static std::optional<Vector2i> parsePositionFromFilename(std::string_view filename);
     static Vector2i getPositionFromFilename(const std::string &filename);
 
 private:
-    static std::vector<std::string> readTileNames(const BytesBuffer &buffer, size_t &offset);
-    static std::vector<Room> readRooms(const BytesBuffer &buffer, size_t &offset);
-    static std::vector<Rectangle> readRectangles(const BytesBuffer &buffer, size_t &offset);
-    static std::vector<RoomObject> readRoomObjects(const BytesBuffer &buffer, size_t &offset);
-    static std::vector<Building> readBuildings(const BytesBuffer &buffer, size_t &offset);
-    static BytesBuffer readSpawns(const BytesBuffer &buffer, size_t &offset);
+    static bool hasMagic(BytesView buffer);
+
+    template <typename Cursor>
+    static LotHeader parse(BytesView buffer, Vector2i position);
+    template <typename Cursor>
+    void readPreamble(Cursor &cursor, bool b41);
+    template <typename Cursor>
+    void readDimensions(Cursor &cursor);
+    void parseSections(BytesView buffer, uint32_t sections);
+    template <typename Cursor>
+    static std::vector<uint32_t> readTileNames(Cursor &cursor);
+    template <typename Cursor>
+    static void readRooms(Cursor &cursor, RoomTable &rooms);
+    template <typename Cursor>
+    static void readBuildings(Cursor &cursor, RoomTable &rooms);
+    template <typename Cursor>
+    static std::vector<uint8_t> readSpawns(Cursor &cursor, size_t chunksCount);
 };
\ No newline at end of file
@@ -1,74 +1,260 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <fmt/format.h>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "constants.h"
 #include "exceptions.h"
-#include "io/binary_reader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
 #include "io/file_reader.h"
 #include "lotpack.h"
+#include "math/fingerprint.h"
+#include "threading/parallel.h"
 #include "types.h"
 
+void Lotpack::SquareTable::reserve(size_t squaresCount, size_t tilesCount)
+{
+    coords.reserve(squaresCount);
+    roomIds.reserve(squaresCount);
+    tileOffsets.reserve(squaresCount + 1);
+    tiles.reserve(tilesCount);
+}
+
+void Lotpack::SquareTable::push(CellCoord coord, uint32_t roomId, std::span<const int32_t> squareTiles)
+{
+    coords.push_back(coord);
+    roomIds.push_back(roomId);
+    tiles.insert(tiles.end(), squareTiles.begin(), squareTiles.end());
+    tileOffsets.push_back(static_cast<uint32_t>(tiles.size()));
+}
+
 Lotpack::Lotpack(const LotHeader *header) : header(header) {}
 
 Lotpack Lotpack::read(const std::string &filename, const LotHeader *header)
 {
-    BytesBuffer buffer = FileReader::read(filename);
+    MappedFile file = FileReader::map(filename);
+
+    return read(file.view(), header);
+}
+
+Lotpack Lotpack::read(BytesView buffer, const LotHeader *header)
+{
+    // the validation pass also counts the squares, so the tables are allocated once
+    if (std::optional<SquareTotals> totals = measure(buffer, header))
+    {
+        return parse<UncheckedBinaryCursor>(buffer, header, *totals);
+    }
+
+    return parse<BinaryCursor>(buffer, header, SquareTotals{});
+}
+
+Lotpack Lotpack::readParallel(const std::string &filename, const LotHeader *header, size_t threads)
+{
+    MappedFile file = FileReader::map(filename);
 
-    return read(buffer, header);
+    return readParallel(file.view(), header, threads);
 }
 
-Lotpack Lotpack::read(const BytesBuffer &buffer, const LotHeader *header)
+Lotpack Lotpack::readParallel(BytesView buffer, const LotHeader *header, size_t threads)
 {
+    std::vector<SquareTotals> blockTotals;
+
+    if (!measure(buffer, header, &blockTotals))
+    {
+        return parse<BinaryCursor>(buffer, header, SquareTotals{});
+    }
+
     Lotpack lotpack(header);
-    size_t offset = 0;
+    UncheckedBinaryCursor cursor(buffer);
 
-    lotpack.magic = BinaryReader::read_n_chars(buffer, 4, offset);
-    lotpack.version = BinaryReader::readInt32(buffer, offset);
-    lotpack.readSquareMap(buffer, offset);
+    lotpack.readPreamble(cursor, !hasMagic(buffer));
+    lotpack.blocksCount = cursor.readInt32();
 
-    if (offset != buffer.size())
+    // first square and tile of every block in the flat arrays
+    std::vector<SquareTotals> blockStarts(lotpack.blocksCount + 1);
+    std::vector<uint32_t> blockOffsets(lotpack.blocksCount);
+
+    for (uint32_t blockIndex = 0; blockIndex < lotpack.blocksCount; blockIndex++)
     {
-        throw Exceptions::FileEndNotReached(offset, buffer.size());
+        blockStarts[blockIndex + 1].squares = blockStarts[blockIndex].squares + blockTotals[blockIndex].squares;
+        blockStarts[blockIndex + 1].tiles = blockStarts[blockIndex].tiles + blockTotals[blockIndex].tiles;
+
+        blockOffsets[blockIndex] = cursor.readInt32();
+        cursor.skip(4);
     }
 
+    SquareTable &squares = lotpack.squares;
+    squares.coords.resize(blockStarts.back().squares);
+    squares.roomIds.resize(blockStarts.back().squares);
+    squares.tileOffsets.resize(blockStarts.back().squares + 1);
+    squares.tiles.resize(blockStarts.back().tiles);
+
+    // every block writes its own ranges of the arrays, no synchronization needed
+    Parallel::forEach(lotpack.blocksCount, [&](size_t blockIndex)
+    {
+        UncheckedBinaryCursor blockCursor(buffer, blockOffsets[blockIndex]);
+        size_t square = blockStarts[blockIndex].squares;
+        size_t tile = blockStarts[blockIndex].tiles;
+
+        lotpack.walkBlock(blockCursor, [&](int8_t x, int8_t y, int8_t z, size_t tilesCount)
+        {
+            squares.coords[square] = CellCoord(static_cast<uint16_t>(blockIndex), x, y, z);
+            squares.roomIds[square] = blockCursor.readInt32();
+            blockCursor.readInt32Array(std::span(squares.tiles).subspan(tile, tilesCount));
+
+            tile += tilesCount;
+            squares.tileOffsets[square + 1] = static_cast<uint32_t>(tile);
+            square++;
+        });
+    }, threads);
+
     return lotpack;
 }
 
-void Lotpack::readSquareMap(const BytesBuffer &buffer, size_t &offset)
+bool Lotpack::validate(BytesView buffer, const LotHeader *header)
 {
-    squareMap = std::vector<SquareData>();
+    return measure(buffer, header).has_value();
+}
+
+std::optional<Lotpack::SquareTotals> Lotpack::measure(BytesView buffer, const LotHeader *header, std::vector<SquareTotals> *blockTotals)
+{
+    try
+    {
+        SquareTotals totals;
+        BinaryCursor cursor(buffer);
+
+        // B41 lotpacks start with the blocks count
+        if (hasMagic(buffer))
+            cursor.skip(8);
+
+        uint32_t blocksCount = cursor.readInt32();
+        size_t tableOffset = cursor.tell();
+
+        if (blocksCount > UINT16_MAX)
+            return std::nullopt;
+
+        if (blockTotals != nullptr)
+            blockTotals->assign(blocksCount, SquareTotals{});
+
+        for (uint32_t blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+        {
+            cursor.seek(tableOffset + blockIndex * 8);
+            cursor.seek(cursor.readInt32());
+
+            SquareTotals blockStart = totals;
 
-    uint32_t blocksCount = BinaryReader::readInt32(buffer, offset);
-    uint32_t tableOffset = static_cast<uint32_t>(offset);
+            // walks the run-length encoding exactly like readBlockSquares, skipping tiles
+            int64_t squaresCount = (header->maxLayer - header->minLayer) * header->blockSizeInSquares() * header->blockSizeInSquares();
+
+            for (int64_t square = 0; square < squaresCount; square++)
+            {
+                int32_t count = cursor.readInt32();
+
+                if (count == -1)
+                {
+                    int32_t skip = cursor.readInt32();
+
+                    if (skip > 0)
+                        square += skip - 1;
+                }
+                else if (count > 1)
+                {
+                    cursor.skip(static_cast<size_t>(count) * 4);
+
+                    totals.squares++;
+                    totals.tiles += count - 1;
+                }
+            }
+
+            if (blockTotals != nullptr)
+                (*blockTotals)[blockIndex] = SquareTotals{ totals.squares - blockStart.squares, totals.tiles - blockStart.tiles };
+        }
+
+        if (!cursor.eof())
+            return std::nullopt;
+
+        return totals;
+    }
+    catch (const std::runtime_error &)
+    {
+        return std::nullopt;
+    }
+}
+
+template <typename Cursor>
+Lotpack Lotpack::parse(BytesView buffer, const LotHeader *header, SquareTotals totals)
+{
+    Lotpack lotpack(header);
+    lotpack.squares.reserve(totals.squares, totals.tiles);
+
+    Cursor cursor(buffer);
+
+    lotpack.readPreamble(cursor, !hasMagic(buffer));
+    lotpack.readSquareMap(cursor);
+
+    if (!cursor.eof())
+    {
+        throw Exceptions::FileEndNotReached(cursor.tell(), cursor.size());
+    }
+
+    return lotpack;
+}
+
+bool Lotpack::hasMagic(BytesView buffer)
+{
+    return buffer.size() >= 4 && std::memcmp(buffer.data(), constants::MAGIC_LOTPACK.data(), 4) == 0;
+}
+
+template <typename Cursor>
+void Lotpack::readPreamble(Cursor &cursor, bool b41)
+{
+    magic = b41 ? "" : cursor.readChars(4);
+    version = b41 ? 0 : cursor.readInt32();
+}
+
+template <typename Cursor>
+void Lotpack::readSquareMap(Cursor &cursor)
+{
+    blocksCount = cursor.readInt32();
+    size_t tableOffset = cursor.tell();
 
     for (uint16_t blockIndex = 0; blockIndex < blocksCount; blockIndex++)
     {
-        offset = tableOffset + blockIndex * 8;
-        offset = BinaryReader::readInt32(buffer, offset);
+        cursor.seek(tableOffset + blockIndex * 8);
+        cursor.seek(cursor.readInt32());
 
-        this->readBlockSquares(buffer, blockIndex, offset);
+        this->readBlockSquares(cursor, blockIndex, squares);
     }
 }
 
-void Lotpack::readBlockSquares(const BytesBuffer &buffer, uint16_t blockIndex, size_t &offset)
+// Decodes the run-length encoding of one block: onSquare(x, y, z, tilesCount)
+// is called with the cursor on the room id, it has to read the room and tiles.
+template <typename Cursor, typename OnSquare>
+void Lotpack::walkBlock(Cursor &cursor, OnSquare &&onSquare) const
 {
+    int8_t blockSize = static_cast<int8_t>(header->blockSizeInSquares());
+    int32_t squaresPerLayer = blockSize * blockSize;
     int32_t skip = 0;
 
     for (int8_t z = header->minLayer; z < header->maxLayer; z++)
     {
-        if (skip >= constants::SQUARE_PER_BLOCK)
+        if (skip >= squaresPerLayer)
         {
-            skip -= constants::SQUARE_PER_BLOCK;
+            skip -= squaresPerLayer;
             continue;
         }
-        for (int8_t x = 0; x < constants::BLOCK_SIZE_IN_SQUARE; x++)
+        for (int8_t x = 0; x < blockSize; x++)
         {
-            if (skip >= constants::BLOCK_SIZE_IN_SQUARE)
+            if (skip >= blockSize)
             {
-                skip -= constants::BLOCK_SIZE_IN_SQUARE;
+                skip -= blockSize;
                 continue;
             }
-            for (int8_t y = 0; y < constants::BLOCK_SIZE_IN_SQUARE; y++)
+            for (int8_t y = 0; y < blockSize; y++)
             {
                 if (skip > 0)
                 {
@@ -76,11 +262,11 @@ void Lotpack::readBlockSquares(const BytesBuffer &buffer, uint16_t blockIndex, s
                     continue;
                 }
 
-                int32_t count = BinaryReader::readInt32(buffer, offset);
+                int32_t count = cursor.readInt32();
 
                 if (count == -1)
                 {
-                    skip = BinaryReader::readInt32(buffer, offset);
+                    skip = cursor.readInt32();
 
                     if (skip > 0)
                     {
@@ -90,27 +276,516 @@ void Lotpack::readBlockSquares(const BytesBuffer &buffer, uint16_t blockIndex, s
                 }
                 else if (count > 1)
                 {
-                    SquareData squareData = Lotpack::readSquare(buffer, count - 1, offset);
-                    squareData.coord = CellCoord(blockIndex, x, y, z);
+                    size_t tilesCount = static_cast<size_t>(count - 1);
+
+                    // checked before the tiles output grows on malformed input
+                    if (tilesCount > cursor.remaining() / 4)
+                        throw std::runtime_error("square tiles out of buffer bounds");
 
-                    squareMap.push_back(squareData);
+                    onSquare(x, y, z, tilesCount);
                 }
             }
         }
     }
 }
 
-SquareData Lotpack::readSquare(const BytesBuffer &buffer, int32_t count, size_t &offset)
+template <typename Cursor>
+void Lotpack::readBlockSquares(Cursor &cursor, uint16_t blockIndex, SquareTable &target) const
+{
+    walkBlock(cursor, [&](int8_t x, int8_t y, int8_t z, size_t tilesCount)
+    {
+        target.coords.push_back(CellCoord(blockIndex, x, y, z));
+        target.roomIds.push_back(cursor.readInt32());
+
+        size_t start = target.tiles.size();
+        target.tiles.resize(start + tilesCount);
+        cursor.readInt32Array(std::span(target.tiles).subspan(start));
+
+        target.tileOffsets.push_back(static_cast<uint32_t>(target.tiles.size()));
+    });
+}
+
+Lotpack Lotpack::open(const std::string &filename, const LotHeader *header)
+{
+    auto file = std::make_shared<MappedFile>(FileReader::map(filename, MappedFile::AccessHint::Random));
+    BytesView view = file->view();
+
+    return openLazy(view, std::move(file), header);
+}
+
+Lotpack Lotpack::open(BytesBuffer buffer, const LotHeader *header)
+{
+    auto owned = std::make_shared<BytesBuffer>(std::move(buffer));
+    BytesView view(*owned);
+
+    return openLazy(view, std::move(owned), header);
+}
+
+Lotpack Lotpack::openLazy(BytesView buffer, std::shared_ptr<const void> owner, const LotHeader *header)
+{
+    Lotpack lotpack(header);
+    BinaryCursor cursor(buffer);
+
+    lotpack.readPreamble(cursor, !hasMagic(buffer));
+    lotpack.blocksCount = cursor.readInt32();
+
+    if (lotpack.blocksCount > UINT16_MAX)
+    {
+        throw std::runtime_error(fmt::format("too many blocks in lotpack: {}", lotpack.blocksCount));
+    }
+
+    lotpack.blockOffsets.resize(lotpack.blocksCount);
+
+    for (uint32_t blockIndex = 0; blockIndex < lotpack.blocksCount; blockIndex++)
+    {
+        uint32_t offset = cursor.readInt32();
+        cursor.skip(4);
+
+        if (offset > buffer.size())
+        {
+            throw std::runtime_error(fmt::format("block {} offset out of lotpack bounds", blockIndex));
+        }
+
+        lotpack.blockOffsets[blockIndex] = offset;
+    }
+
+    lotpack.lazy = true;
+    lotpack.sourceOwner = std::move(owner);
+    lotpack.source = buffer;
+    lotpack.blocks.resize(lotpack.blocksCount);
+
+    return lotpack;
+}
+
+Lotpack Lotpack::map(SquareView view, std::span<const uint32_t> blockSquares, std::shared_ptr<const void> owner, const LotHeader *header, bool lazy)
+{
+    if (blockSquares.empty() || blockSquares.back() != view.size())
+    {
+        throw std::runtime_error("mapped block ranges don't match the squares");
+    }
+
+    Lotpack lotpack(header);
+    lotpack.blocksCount = static_cast<uint32_t>(blockSquares.size() - 1);
+    lotpack.lazy = lazy;
+    lotpack.mapped = true;
+    lotpack.sourceOwner = std::move(owner);
+    lotpack.mappedSquares = view;
+    lotpack.mappedBlockSquares = blockSquares;
+
+    if (lazy)
+        lotpack.mappedLoaded.assign(lotpack.blocksCount, 0);
+
+    return lotpack;
+}
+
+bool Lotpack::isBlockLoaded(uint32_t blockIndex) const
 {
-    SquareData squareData{};
+    if (!lazy)
+        return blockIndex < blocksCount;
+
+    if (blockIndex >= blocksCount)
+        return false;
+
+    return mapped ? mappedLoaded[blockIndex] != 0 : blocks[blockIndex].has_value();
+}
+
+Lotpack::SquareView Lotpack::loadBlock(uint32_t blockIndex)
+{
+    if (!lazy && !mapped)
+    {
+        throw std::runtime_error("lotpack is not opened lazily");
+    }
+
+    if (blockIndex >= blocksCount)
+    {
+        throw std::out_of_range("block out of lotpack bounds");
+    }
+
+    if (mapped)
+    {
+        // nothing to decode, the block is only made visible to forEachLoadedTable
+        if (lazy)
+            mappedLoaded[blockIndex] = 1;
+
+        return mappedSquares.subview(mappedBlockSquares[blockIndex], mappedBlockSquares[blockIndex + 1]);
+    }
 
-    squareData.roomId = BinaryReader::readInt32(buffer, offset);
-    squareData.tiles = std::vector<int32_t>(count);
+    std::optional<SquareTable> &block = blocks[blockIndex];
 
-    for (int i = 0; i < count; i++)
+    if (!block)
     {
-        squareData.tiles[i] = BinaryReader::readInt32(buffer, offset);
+        // blocks are decoded one at a time, checked reads cost little at this size
+        SquareTable table;
+        BinaryCursor cursor(source, blockOffsets[blockIndex]);
+        readBlockSquares(cursor, static_cast<uint16_t>(blockIndex), table);
+
+        block = std::move(table);
     }
 
-    return squareData;
+    return block->view();
+}
+
+Lotpack::SquareView Lotpack::view() const
+{
+    if (mapped)
+        return mappedSquares;
+
+    if (lazy)
+    {
+        throw std::runtime_error("lotpack opened lazily, squares are stored per block");
+    }
+
+    return squares.view();
+}
+
+size_t Lotpack::loadChunks(int chunkX0, int chunkY0, int chunkX1, int chunkY1)
+{
+    size_t loaded = 0;
+    int cellSize = header->cellSizeInBlocks();
+
+    chunkX0 = std::max(chunkX0, 0);
+    chunkY0 = std::max(chunkY0, 0);
+    chunkX1 = std::min(chunkX1, cellSize - 1);
+    chunkY1 = std::min(chunkY1, cellSize - 1);
+
+    for (int chunkX = chunkX0; chunkX <= chunkX1; chunkX++)
+    {
+        for (int chunkY = chunkY0; chunkY <= chunkY1; chunkY++)
+        {
+            uint32_t index = blockIndex(chunkX, chunkY, cellSize);
+
+            if (index >= blocksCount || isBlockLoaded(index))
+                continue;
+
+            loadBlock(index);
+            loaded++;
+        }
+    }
+
+    return loaded;
+}
+
+std::vector<uint64_t> Lotpack::blockHashes(size_t threads) const
+{
+    if (!header->hasSections(LotHeader::SECTION_TILE_NAMES))
+    {
+        throw std::runtime_error("block hashes need the lotheader tile names");
+    }
+
+    std::vector<uint64_t> tileHashes(header->tileIds.size());
+    for (size_t tile = 0; tile < tileHashes.size(); tile++)
+    {
+        std::string_view name = header->tileName(tile);
+        tileHashes[tile] = Fingerprint::hash64(BytesView(reinterpret_cast<const uint8_t *>(name.data()), name.size()));
+    }
+
+    auto appendSquare = [&](std::vector<uint64_t> &words, CellCoord coord, uint32_t roomId, std::span<const int32_t> tiles)
+    {
+        uint64_t position = (static_cast<uint64_t>(coord.z() + 128) << 16) | (static_cast<uint64_t>(coord.x()) << 8) | static_cast<uint64_t>(coord.y());
+
+        words.push_back((position << 32) | roomId);
+        words.push_back(tiles.size());
+
+        for (int32_t tile : tiles)
+        {
+            words.push_back(tileHashes.at(static_cast<uint32_t>(tile)));
+        }
+    };
+
+    auto hashWords = [](const std::vector<uint64_t> &words)
+    {
+        return Fingerprint::hash64(BytesView(reinterpret_cast<const uint8_t *>(words.data()), words.size() * sizeof(uint64_t)));
+    };
+
+    // lotpacks opened from a file are walked, decoded and mapped ones hash their squares
+    bool walk = lazy && !mapped;
+    SquareView all = walk ? SquareView{} : view();
+    std::vector<size_t> offsets = walk ? std::vector<size_t>() : blockSquareOffsets();
+    std::vector<uint64_t> hashes(blocksCount);
+
+    Parallel::forEach(blocksCount, [&](size_t blockIndex)
+    {
+        std::vector<uint64_t> words;
+
+        if (walk)
+        {
+            BinaryCursor cursor(source, blockOffsets[blockIndex]);
+            std::vector<int32_t> tiles;
+
+            walkBlock(cursor, [&](int8_t x, int8_t y, int8_t z, size_t tilesCount)
+            {
+                uint32_t roomId = cursor.readInt32();
+
+                tiles.resize(tilesCount);
+                cursor.readInt32Array(std::span(tiles));
+
+                appendSquare(words, CellCoord(static_cast<uint16_t>(blockIndex), x, y, z), roomId, tiles);
+            });
+        }
+        else
+        {
+            for (size_t square = offsets[blockIndex]; square < offsets[blockIndex + 1]; square++)
+            {
+                appendSquare(words, all.coords[square], all.roomIds[square], all.squareTiles(square));
+            }
+        }
+
+        hashes[blockIndex] = hashWords(words);
+    }, threads);
+
+    return hashes;
+}
+
+void Lotpack::buildSquareIndex()
+{
+    if (header->isB41())
+    {
+        throw std::runtime_error("B41 blocks don't fit an occupancy word");
+    }
+
+    SquareView all = view();
+
+    squareIndex.minLayer = header->minLayer;
+    squareIndex.layersCount = header->maxLayer - header->minLayer;
+
+    size_t wordsCount = static_cast<size_t>(blocksCount) * squareIndex.layersCount;
+    squareIndex.occupancy.assign(wordsCount, 0);
+    squareIndex.ranks.assign(wordsCount, 0);
+
+    for (CellCoord coord : all.coords)
+    {
+        size_t word = static_cast<size_t>(coord.chunk_idx()) * squareIndex.layersCount + (coord.z() - squareIndex.minLayer);
+        squareIndex.occupancy[word] |= uint64_t{ 1 } << (coord.x() * constants::BLOCK_SIZE_IN_SQUARE + coord.y());
+    }
+
+    uint32_t rank = 0;
+    for (size_t word = 0; word < wordsCount; word++)
+    {
+        squareIndex.ranks[word] = rank;
+        rank += std::popcount(squareIndex.occupancy[word]);
+    }
+
+    // ranks only give table indices when squares are unique and in file order
+    for (size_t square = 0; square < all.size(); square++)
+    {
+        CellCoord coord = all.coords[square];
+        int chunkX = coord.chunk_idx() / constants::CELL_SIZE_IN_BLOCKS;
+        int chunkY = coord.chunk_idx() % constants::CELL_SIZE_IN_BLOCKS;
+
+        std::optional<uint32_t> found = getSquare(chunkX * constants::BLOCK_SIZE_IN_SQUARE + coord.x(), chunkY * constants::BLOCK_SIZE_IN_SQUARE + coord.y(), coord.z());
+
+        if (found != square)
+        {
+            squareIndex = SquareIndex{};
+            throw std::runtime_error("squares are not unique or not in file order");
+        }
+    }
+}
+
+std::optional<uint32_t> Lotpack::getSquare(int x, int y, int z) const
+{
+    if (squareIndex.empty())
+    {
+        throw std::runtime_error("square index not built");
+    }
+
+    if (x < 0 || y < 0 || x >= constants::CELL_SIZE_IN_SQUARE || y >= constants::CELL_SIZE_IN_SQUARE)
+        return std::nullopt;
+
+    int layer = z - squareIndex.minLayer;
+    if (layer < 0 || layer >= squareIndex.layersCount)
+        return std::nullopt;
+
+    uint32_t block = blockIndex(x / constants::BLOCK_SIZE_IN_SQUARE, y / constants::BLOCK_SIZE_IN_SQUARE);
+    if (block >= blocksCount)
+        return std::nullopt;
+
+    size_t word = static_cast<size_t>(block) * squareIndex.layersCount + layer;
+    uint64_t bit = uint64_t{ 1 } << ((x % constants::BLOCK_SIZE_IN_SQUARE) * constants::BLOCK_SIZE_IN_SQUARE + y % constants::BLOCK_SIZE_IN_SQUARE);
+    uint64_t occupancy = squareIndex.occupancy[word];
+
+    if ((occupancy & bit) == 0)
+        return std::nullopt;
+
+    return squareIndex.ranks[word] + std::popcount(occupancy & (bit - 1));
+}
+
+std::vector<size_t> Lotpack::blockSquareOffsets() const
+{
+    // checked when the cache was opened
+    if (mapped)
+        return std::vector<size_t>(mappedBlockSquares.begin(), mappedBlockSquares.end());
+
+    std::vector<size_t> offsets(blocksCount + 1, squares.size());
+    size_t square = 0;
+
+    for (uint32_t blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+    {
+        offsets[blockIndex] = square;
+
+        while (square < squares.size() && squares.coords[square].chunk_idx() == blockIndex)
+        {
+            square++;
+        }
+    }
+
+    if (square != squares.size())
+    {
+        throw std::runtime_error("square map contains squares outside of the blocks range or out of order");
+    }
+
+    return offsets;
+}
+
+// Reports the tokens of the run-length encoding of one block: empty squares
+// are grouped into skip runs, stored squares are reported by index.
+// squares must be ordered like the decoder produces them.
+template <typename OnSkip, typename OnSquare>
+void Lotpack::encodeBlock(const SquareView &all, uint32_t blockIndex, size_t firstSquare, size_t lastSquare, OnSkip &&onSkip, OnSquare &&onSquare) const
+{
+    int32_t blockSize = header->blockSizeInSquares();
+    int32_t squaresPerBlock = (header->maxLayer - header->minLayer) * blockSize * blockSize;
+    int32_t nextPosition = 0;
+    int32_t previousPosition = -1;
+
+    for (size_t square = firstSquare; square < lastSquare; square++)
+    {
+        CellCoord coord = all.coords[square];
+        int32_t position = (coord.z() - header->minLayer) * blockSize * blockSize + coord.x() * blockSize + coord.y();
+
+        if (position <= previousPosition || position >= squaresPerBlock)
+        {
+            throw std::runtime_error(fmt::format("square out of order in block {}", blockIndex));
+        }
+
+        previousPosition = position;
+
+        // the format has no room for a square without tiles, it joins the skip run around it
+        if (all.tileOffsets[square] == all.tileOffsets[square + 1])
+            continue;
+
+        if (position > nextPosition)
+        {
+            onSkip(position - nextPosition);
+        }
+
+        onSquare(square);
+        nextPosition = position + 1;
+    }
+
+    if (nextPosition < squaresPerBlock)
+    {
+        onSkip(squaresPerBlock - nextPosition);
+    }
+}
+
+size_t Lotpack::blockSize(const SquareView &all, uint32_t blockIndex, size_t firstSquare, size_t lastSquare) const
+{
+    size_t size = 0;
+
+    encodeBlock(
+        all, blockIndex, firstSquare, lastSquare,
+        [&size](int32_t) { size += 8; },
+        [&](size_t square) { size += 8 + all.squareTiles(square).size() * 4; });
+
+    return size;
+}
+
+size_t Lotpack::preambleSize() const
+{
+    // B41 lotpacks have neither magic nor version
+    return (isB41() ? 0 : magic.size() + 4) + 4 + static_cast<size_t>(blocksCount) * 8;
+}
+
+size_t Lotpack::serializedSize() const
+{
+    if (lazy && !mapped)
+    {
+        throw std::runtime_error("lotpack opened lazily, can't be written");
+    }
+
+    SquareView all = view();
+    std::vector<size_t> offsets = blockSquareOffsets();
+    size_t size = preambleSize();
+
+    for (uint32_t blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+    {
+        size += blockSize(all, blockIndex, offsets[blockIndex], offsets[blockIndex + 1]);
+    }
+
+    return size;
+}
+
+BytesBuffer Lotpack::write(size_t threads) const
+{
+    if (lazy && !mapped)
+    {
+        throw std::runtime_error("lotpack opened lazily, can't be written");
+    }
+
+    SquareView all = view();
+    std::vector<size_t> offsets = blockSquareOffsets();
+    std::vector<BytesBuffer> blocks(blocksCount);
+
+    // blocks are independent: each one is encoded into its own buffer
+    Parallel::forEach(blocksCount, [&](size_t blockIndex)
+    {
+        uint32_t index = static_cast<uint32_t>(blockIndex);
+        BinaryWriter writer(blockSize(all, index, offsets[index], offsets[index + 1]));
+
+        encodeBlock(
+            all, index, offsets[index], offsets[index + 1],
+            [&](int32_t skip)
+        {
+            writer.writeInt32(-1);
+            writer.writeInt32(skip);
+        },
+            [&](size_t square)
+        {
+            std::span<const int32_t> tiles = all.squareTiles(square);
+
+            writer.writeInt32(static_cast<int32_t>(tiles.size()) + 1);
+            writer.writeInt32(all.roomIds[square]);
+            writer.writeInt32Array(tiles);
+        });
+
+        blocks[blockIndex] = writer.finish();
+    }, threads);
+
+    size_t size = preambleSize();
+    for (const BytesBuffer &block : blocks)
+    {
+        size += block.size();
+    }
+
+    BinaryWriter writer(size);
+
+    if (!isB41())
+    {
+        writer.writeChars(magic);
+        writer.writeInt32(version);
+    }
+
+    writer.writeInt32(blocksCount);
+
+    // block offsets are 64 bits values, known once every block is encoded
+    size_t blockOffset = preambleSize();
+
+    for (const BytesBuffer &block : blocks)
+    {
+        writer.writeInt64(static_cast<int64_t>(blockOffset));
+        blockOffset += block.size();
+    }
+
+    for (const BytesBuffer &block : blocks)
+    {
+        writer.writeBytes(block);
+    }
+
+    return writer.finish();
+}
+
+void Lotpack::save(const std::string &filename) const
+{
+    FileReader::save(write(), filename);
 }
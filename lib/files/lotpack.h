@@ -1,35 +1,213 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "constants.h"
 #include "core/cell_coord.h"
 #include "files/lotheader.h"
-
-struct SquareData
-{
-    CellCoord coord;
-    uint32_t roomId;
-    std::vector<int32_t> tiles;
-};
+#include "io/binary_cursor.h"
 
 class Lotpack
 {
 public:
+    // Read-only squares of a table or of a range of one: tileOffsets has
+    // size() + 1 entries that index tiles, which may start past 0 when the
+    // view is a block of a larger table.
+    struct SquareView
+    {
+        std::span<const CellCoord> coords;
+        std::span<const uint32_t> roomIds;
+        std::span<const uint32_t> tileOffsets;
+        std::span<const int32_t> tiles;
+
+        inline size_t size() const { return coords.size(); }
+        inline bool empty() const { return coords.empty(); }
+
+        inline std::span<const int32_t> squareTiles(size_t square) const
+        {
+            return tiles.subspan(tileOffsets[square], tileOffsets[square + 1] - tileOffsets[square]);
+        }
+
+        // squares [first, last), tiles keep their indices
+        inline SquareView subview(size_t first, size_t last) const
+        {
+            return SquareView{ coords.subspan(first, last - first), roomIds.subspan(first, last - first), tileOffsets.subspan(first, last - first + 1), tiles };
+        }
+    };
+
+    // Non-empty squares stored as flat arrays, in file order: square i owns
+    // the [tileOffsets[i], tileOffsets[i + 1]) range of tiles.
+    struct SquareTable
+    {
+        std::vector<CellCoord> coords;
+        std::vector<uint32_t> roomIds;
+        std::vector<uint32_t> tileOffsets{ 0 };
+        std::vector<int32_t> tiles;
+
+        inline size_t size() const { return coords.size(); }
+        inline bool empty() const { return coords.empty(); }
+
+        inline std::span<const int32_t> squareTiles(size_t square) const
+        {
+            return std::span(tiles).subspan(tileOffsets[square], tileOffsets[square + 1] - tileOffsets[square]);
+        }
+
+        inline SquareView view() const { return SquareView{ coords, roomIds, tileOffsets, tiles }; }
+
+        void reserve(size_t squaresCount, size_t tilesCount);
+        void push(CellCoord coord, uint32_t roomId, std::span<const int32_t> squareTiles);
+    };
+
+    // Occupancy of the cell: one 64 bits word per (block, layer), bit x * 8 + y,
+    // and the number of squares stored before each word. The index of a
+    // square in the table is its word rank plus a popcount, which keeps
+    // lookups constant time without a dense 256x256xlayers grid.
+    struct SquareIndex
+    {
+        int32_t minLayer = 0;
+        int32_t layersCount = 0;
+        std::vector<uint64_t> occupancy;
+        std::vector<uint32_t> ranks;
+
+        inline bool empty() const { return occupancy.empty(); }
+    };
+
+    static_assert(constants::SQUARE_PER_BLOCK == 64, "a block layer must fit an occupancy word");
+
     const LotHeader *header;
 
-    std::string magic;
-    uint32_t version;
-    std::vector<SquareData> squareMap;
+    std::string magic = std::string(constants::MAGIC_LOTPACK);
+    uint32_t version = 1;
+    uint32_t blocksCount = 0;
+    SquareTable squares;
+    SquareIndex squareIndex;
 
     Lotpack() = default;
     Lotpack(const LotHeader *header);
 
     static Lotpack read(const std::string &filename, const LotHeader *header);
-    static Lotpack read(const BytesBuffer &buffer, const LotHeader *header);
+    static Lotpack read(BytesView buffer, const LotHeader *header);
+    static bool validate(BytesView buffer, const LotHeader *header);
+
+    // Same result as read: blocks are counted first, then decoded
+    // concurrently straight into their ranges of the square table.
+    static Lotpack readParallel(const std::string &filename, const LotHeader *header, size_t threads = 0);
+    static Lotpack readParallel(BytesView buffer, const LotHeader *header, size_t threads = 0);
+
+    // Lazy mode: only the block offset table is read, each block is decoded
+    // on first access into its own table and kept. squares stays empty.
+    // The file is shared between copies; loading blocks is not thread-safe.
+    static Lotpack open(const std::string &filename, const LotHeader *header);
+    static Lotpack open(BytesBuffer buffer, const LotHeader *header);
+
+    // Mapped mode: squares are views of arrays kept alive by owner (a mapped
+    // CellCache), nothing is decoded nor copied and squares stays empty.
+    // blockSquares holds the first square of every block, blocksCount + 1
+    // entries. A lazy mapped lotpack only visits the blocks loaded so far.
+    static Lotpack map(SquareView view, std::span<const uint32_t> blockSquares, std::shared_ptr<const void> owner, const LotHeader *header, bool lazy = false);
+
+    inline bool isLazy() const { return lazy; }
+    inline bool isMapped() const { return mapped; }
+    bool isBlockLoaded(uint32_t blockIndex) const;
+    SquareView loadBlock(uint32_t blockIndex);
+
+    // every square of the cell, throws when opened lazily from a lotpack file
+    SquareView view() const;
+
+    // decodes the blocks of the chunks in [chunkX0, chunkX1] x [chunkY0, chunkY1],
+    // clamped to the cell, and returns how many were not loaded yet
+    size_t loadChunks(int chunkX0, int chunkY0, int chunkX1, int chunkY1);
+
+    static inline uint32_t blockIndex(int chunkX, int chunkY, int cellSizeInBlocks = constants::CELL_SIZE_IN_BLOCKS)
+    {
+        return chunkX * cellSizeInBlocks + chunkY;
+    }
+
+    // B41 lotpacks have no magic nor version, see LotHeader::isB41
+    inline bool isB41() const { return magic.empty(); }
+
+    // calls visit(const SquareView &) for the whole cell, or for each loaded block in lazy mode
+    template <typename Visitor>
+    void forEachLoadedTable(Visitor &&visit) const
+    {
+        if (!lazy)
+        {
+            visit(view());
+            return;
+        }
+
+        for (uint32_t blockIndex = 0; blockIndex < blocksCount; blockIndex++)
+        {
+            if (mapped && mappedLoaded[blockIndex])
+                visit(mappedSquares.subview(mappedBlockSquares[blockIndex], mappedBlockSquares[blockIndex + 1]));
+            else if (!mapped && blocks[blockIndex])
+                visit(blocks[blockIndex]->view());
+        }
+    }
+
+    // Content hash of every block, from the squares positions, rooms and tile
+    // names: lotpacks listing their tiles in another order still match. Lazy
+    // lotpacks walk their blocks in a pass of their own without keeping them,
+    // so that only the blocks found different have to be decoded.
+    std::vector<uint64_t> blockHashes(size_t threads = 0) const;
+
+    // squares must be in file order, throws when opened lazily from a lotpack
+    // file and for B41 cells
+    void buildSquareIndex();
+
+    // index in view() of the square at cell coordinates, nullopt when empty or
+    // outside of the cell; buildSquareIndex must have been called
+    std::optional<uint32_t> getSquare(int x, int y, int z) const;
+
+    // blocks are encoded concurrently on up to `threads` threads (0 = hardware concurrency)
+    size_t serializedSize() const;
+    BytesBuffer write(size_t threads = 0) const;
+    void save(const std::string &filename) const;
+
+private:
+    bool lazy = false;
+    bool mapped = false;
+    std::shared_ptr<const void> sourceOwner;
+    BytesView source;
+    std::vector<uint32_t> blockOffsets;
+    std::vector<std::optional<SquareTable>> blocks;
+
+    SquareView mappedSquares;
+    std::span<const uint32_t> mappedBlockSquares;
+    std::vector<uint8_t> mappedLoaded;
+
+    static Lotpack openLazy(BytesView buffer, std::shared_ptr<const void> owner, const LotHeader *header);
+    static bool hasMagic(BytesView buffer);
+
+    struct SquareTotals
+    {
+        size_t squares = 0;
+        size_t tiles = 0;
+    };
+
+    // walks the whole encoding, nullopt when the buffer is malformed
+    // per block counts are stored in blockTotals when given
+    static std::optional<SquareTotals> measure(BytesView buffer, const LotHeader *header, std::vector<SquareTotals> *blockTotals = nullptr);
 
-    void readSquareMap(const BytesBuffer &buffer, size_t &offset);
-    void readBlockSquares(const BytesBuffer &buffer, uint16_t blockIndex, size_t &offset);
-    static SquareData readSquare(const BytesBuffer &buffer, int32_t count,size_t &offset);
+    template <typename Cursor>
+    static Lotpack parse(BytesView buffer, const LotHeader *header, SquareTotals totals);
+    template <typename Cursor>
+    void readPreamble(Cursor &cursor, bool b41);
+    template <typename Cursor>
+    void readSquareMap(Cursor &cursor);
+    template <typename Cursor, typename OnSquare>
+    void walkBlock(Cursor &cursor, OnSquare &&onSquare) const;
+    template <typename Cursor>
+    void readBlockSquares(Cursor &cursor, uint16_t blockIndex, SquareTable &target) const;
+    // first square of every block, blocksCount + 1 entries
+    std::vector<size_t> blockSquareOffsets() const;
+    template <typename OnSkip, typename OnSquare>
+    void encodeBlock(const SquareView &all, uint32_t blockIndex, size_t firstSquare, size_t lastSquare, OnSkip &&onSkip, OnSquare &&onSquare) const;
+    size_t blockSize(const SquareView &all, uint32_t blockIndex, size_t firstSquare, size_t lastSquare) const;
+    size_t preambleSize() const;
 };
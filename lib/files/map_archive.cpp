@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <lodepng.h>
+#include <stdexcept>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
+#include "io/file_reader.h"
+#include "map_archive.h"
+#include "math/fingerprint.h"
+
+namespace fs = std::filesystem;
+
+uint64_t MapArchive::key(Vector2i position, EntryType type)
+{
+    // 31 bits per coordinate and the entry type in the lowest bit
+    uint64_t x = static_cast<uint32_t>(position.x) & 0x7FFFFFFF;
+    uint64_t y = static_cast<uint32_t>(position.y) & 0x7FFFFFFF;
+
+    return (x << 33) | (y << 1) | static_cast<uint64_t>(type);
+}
+
+MapArchive MapArchive::open(const std::string &path)
+{
+    MapArchive archive;
+    archive.file = FileReader::map(path, MappedFile::AccessHint::Random);
+
+    BinaryCursor cursor(archive.file.view());
+
+    if (cursor.readChars(4) != MAGIC)
+    {
+        throw std::runtime_error("Not a map archive: " + path);
+    }
+
+    uint32_t version = cursor.readInt32();
+    if (version != VERSION)
+    {
+        throw std::runtime_error("Unsupported map archive version: " + std::to_string(version));
+    }
+
+    uint32_t entriesCount = cursor.readInt32();
+    cursor.seek(static_cast<uint64_t>(cursor.readInt64()));
+
+    archive.entries.resize(entriesCount);
+    archive.entryByKey.reserve(entriesCount);
+
+    for (uint32_t i = 0; i < entriesCount; i++)
+    {
+        Entry &entry = archive.entries[i];
+
+        entry.position.x = cursor.readInt32();
+        entry.position.y = cursor.readInt32();
+        entry.type = static_cast<EntryType>(cursor.readInt32());
+        entry.flags = cursor.readInt32();
+        entry.offset = cursor.readInt64();
+        entry.storedSize = cursor.readInt64();
+        entry.rawSize = cursor.readInt64();
+        entry.hash = cursor.readInt64();
+
+        if (entry.offset > archive.file.size() || entry.storedSize > archive.file.size() - entry.offset)
+        {
+            throw std::runtime_error("Map archive entry out of bounds: " + path);
+        }
+
+        archive.entryByKey[key(entry.position, entry.type)] = i;
+    }
+
+    return archive;
+}
+
+size_t MapArchive::build(const std::string &mapDirectory, const std::string &archivePath, bool compress)
+{
+    std::vector<fs::path> headerPaths;
+
+    for (auto &entry : fs::directory_iterator(mapDirectory))
+    {
+        if (entry.path().extension().string() == constants::LOTHEADER_EXT)
+        {
+            headerPaths.push_back(entry.path());
+        }
+    }
+
+    // sorted so that building twice from the same files gives the same archive
+    std::sort(headerPaths.begin(), headerPaths.end());
+
+    std::ofstream output(archivePath, std::ios::binary | std::ios::trunc);
+    if (!output)
+    {
+        throw std::runtime_error("Can't open file for writing: " + archivePath);
+    }
+
+    std::vector<Entry> entries;
+    uint64_t offset = HEADER_SIZE;
+    BytesBuffer compressed;
+
+    auto append = [&](const fs::path &path, Vector2i position, EntryType type)
+    {
+        MappedFile mappedFile = FileReader::map(path.string());
+        BytesView payload = mappedFile.view();
+
+        Entry entry{ position, type, 0, offset, payload.size(), payload.size(), Fingerprint::hash64(payload) };
+
+        // lodepng appends to its output
+        compressed.clear();
+
+        // keep the raw payload when deflate does not pay off
+        if (compress && !payload.empty() && lodepng::compress(compressed, payload.data(), payload.size()) == 0 && compressed.size() < payload.size())
+        {
+            entry.flags |= FLAG_DEFLATE;
+            entry.storedSize = compressed.size();
+            payload = compressed;
+        }
+
+        output.seekp(static_cast<std::streamoff>(offset));
+        output.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+
+        offset += entry.storedSize;
+        entries.push_back(entry);
+    };
+
+    for (const fs::path &headerPath : headerPaths)
+    {
+        Vector2i position = LotHeader::getPositionFromFilename(headerPath.string());
+        fs::path lotpackPath = headerPath;
+        lotpackPath.replace_filename("world_" + headerPath.filename().replace_extension(constants::LOTPACK_EXT).string());
+
+        append(headerPath, position, EntryType::LotHeader);
+        append(lotpackPath, position, EntryType::Lotpack);
+    }
+
+    BinaryWriter header(HEADER_SIZE);
+    header.writeChars(MAGIC);
+    header.writeInt32(VERSION);
+    header.writeInt32(static_cast<int32_t>(entries.size()));
+    header.writeInt64(static_cast<int64_t>(offset));
+
+    BinaryWriter index(entries.size() * ENTRY_SIZE);
+    for (const Entry &entry : entries)
+    {
+        index.writeInt32(entry.position.x);
+        index.writeInt32(entry.position.y);
+        index.writeInt32(static_cast<int32_t>(entry.type));
+        index.writeInt32(entry.flags);
+        index.writeInt64(entry.offset);
+        index.writeInt64(entry.storedSize);
+        index.writeInt64(entry.rawSize);
+        index.writeInt64(entry.hash);
+    }
+
+    BytesBuffer headerBuffer = header.finish();
+    BytesBuffer indexBuffer = index.finish();
+
+    output.seekp(0);
+    output.write(reinterpret_cast<const char *>(headerBuffer.data()), headerBuffer.size());
+    output.seekp(static_cast<std::streamoff>(offset));
+    output.write(reinterpret_cast<const char *>(indexBuffer.data()), indexBuffer.size());
+
+    if (!output)
+    {
+        throw std::runtime_error("Failed to write to file: " + archivePath);
+    }
+
+    return entries.size();
+}
+
+const MapArchive::Entry *MapArchive::find(Vector2i position, EntryType type) const
+{
+    auto it = entryByKey.find(key(position, type));
+
+    if (it == entryByKey.end())
+        return nullptr;
+
+    return &entries[it->second];
+}
+
+BytesView MapArchive::read(const Entry &entry, BytesBuffer &scratch) const
+{
+    BytesView payload = file.view().subspan(entry.offset, entry.storedSize);
+
+    if (entry.flags & FLAG_DEFLATE)
+    {
+        // lodepng appends to its output
+        scratch.clear();
+        scratch.reserve(entry.rawSize);
+
+        if (lodepng::decompress(scratch, payload.data(), payload.size()) != 0 || scratch.size() != entry.rawSize)
+        {
+            throw std::runtime_error("failed inflating map archive entry.");
+        }
+
+        payload = scratch;
+    }
+
+    if (Fingerprint::hash64(payload) != entry.hash)
+    {
+        throw std::runtime_error("map archive entry hash mismatch.");
+    }
+
+    return payload;
+}
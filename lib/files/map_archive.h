@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "io/mapped_file.h"
+#include "math/vector2i.h"
+#include "types.h"
+
+// Single file holding every lotheader and lotpack of a map.
+//
+// layout: "PZMA", version, entries count, index offset (int64),
+// then the entries payloads, then the index (one Entry per file).
+// Payloads are stored raw or zlib compressed, the hash is the XXH64
+// of the raw payload.
+class MapArchive
+{
+public:
+    enum class EntryType : uint32_t
+    {
+        LotHeader = 0,
+        Lotpack = 1,
+    };
+
+    struct Entry
+    {
+        Vector2i position;
+        EntryType type;
+        uint32_t flags;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t rawSize;
+        uint64_t hash;
+    };
+
+    static constexpr uint32_t FLAG_DEFLATE = 1;
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 4 + 4 + 4 + 8;
+    static constexpr size_t ENTRY_SIZE = 4 * 4 + 4 * 8;
+
+    static constexpr std::string_view MAGIC = "PZMA";
+    static constexpr std::string_view EXTENSION = ".pzma";
+
+private:
+    MappedFile file;
+    std::vector<Entry> entries;
+    std::unordered_map<uint64_t, size_t> entryByKey;
+
+    static uint64_t key(Vector2i position, EntryType type);
+
+public:
+    MapArchive() = default;
+
+    static MapArchive open(const std::string &path);
+
+    // packs the lotheader/lotpack pairs of a map directory, returns the entries count
+    static size_t build(const std::string &mapDirectory, const std::string &archivePath, bool compress = true);
+
+    inline const std::vector<Entry> &getEntries() const { return entries; }
+    const Entry *find(Vector2i position, EntryType type) const;
+
+    // returns a view into the mapping for raw entries, compressed entries
+    // are inflated into scratch and the view points there
+    BytesView read(const Entry &entry, BytesBuffer &scratch) const;
+};
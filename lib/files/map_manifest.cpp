@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
+#include "io/file_reader.h"
+#include "map_manifest.h"
+#include "threading/parallel.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    inline int64_t toStamp(fs::file_time_type time)
+    {
+        return static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    inline bool samePosition(Vector2i a, Vector2i b)
+    {
+        return a.x == b.x && a.y == b.y;
+    }
+
+    inline bool positionLess(const MapManifest::Cell &a, const MapManifest::Cell &b)
+    {
+        return a.position.x != b.position.x ? a.position.x < b.position.x : a.position.y < b.position.y;
+    }
+
+    // updates size and mtime, returns true when they changed
+    bool restat(const fs::directory_entry &entry, MapManifest::FileStamp &stamp)
+    {
+        uint64_t size = entry.file_size();
+        int64_t mtime = toStamp(entry.last_write_time());
+
+        if (size == stamp.size && mtime == stamp.mtime)
+            return false;
+
+        stamp.size = size;
+        stamp.mtime = mtime;
+        return true;
+    }
+
+    void readStamp(BinaryCursor &cursor, MapManifest::FileStamp &stamp)
+    {
+        stamp.size = static_cast<uint64_t>(cursor.readInt64());
+        stamp.mtime = cursor.readInt64();
+        stamp.hash.low = static_cast<uint64_t>(cursor.readInt64());
+        stamp.hash.high = static_cast<uint64_t>(cursor.readInt64());
+    }
+
+    void writeStamp(BinaryWriter &writer, const MapManifest::FileStamp &stamp)
+    {
+        writer.writeInt64(static_cast<int64_t>(stamp.size));
+        writer.writeInt64(stamp.mtime);
+        writer.writeInt64(static_cast<int64_t>(stamp.hash.low));
+        writer.writeInt64(static_cast<int64_t>(stamp.hash.high));
+    }
+
+    // (cell index, lotpack) pairs whose content hash has to be computed
+    using StaleFiles = std::vector<std::pair<size_t, bool>>;
+
+    void hashFiles(MapManifest &manifest, const StaleFiles &stale, size_t threads)
+    {
+        Parallel::forEach(stale.size(), [&](size_t i)
+        {
+            MapManifest::Cell &cell = manifest.cells[stale[i].first];
+
+            if (stale[i].second)
+                cell.lotpack.hash = Fingerprint::file(manifest.lotpackPath(cell));
+            else
+                cell.lotheader.hash = Fingerprint::file(manifest.lotheaderPath(cell));
+        }, threads);
+    }
+}
+
+MapManifest MapManifest::scan(const std::string &mapDirectory, const MapManifest *previous, size_t threads)
+{
+    MapManifest manifest;
+    manifest.mapDirectory = mapDirectory;
+
+    // taken before listing, a file added meanwhile triggers a new scan next time
+    manifest.directoryMtime = toStamp(fs::last_write_time(mapDirectory));
+
+    for (const fs::directory_entry &entry : fs::directory_iterator(mapDirectory))
+    {
+        std::optional<Vector2i> position = LotHeader::parsePositionFromFilename(entry.path().filename().string());
+        if (!position)
+            continue;
+
+        Cell cell{ *position, {}, {} };
+
+        // a cell can't be loaded without its lotpack
+        fs::directory_entry lotpack(manifest.lotpackPath(cell));
+        if (!lotpack.is_regular_file())
+            continue;
+
+        restat(entry, cell.lotheader);
+        restat(lotpack, cell.lotpack);
+        manifest.cells.push_back(cell);
+    }
+
+    std::sort(manifest.cells.begin(), manifest.cells.end(), positionLess);
+
+    StaleFiles stale;
+
+    for (size_t i = 0; i < manifest.cells.size(); i++)
+    {
+        Cell &cell = manifest.cells[i];
+        const Cell *known = nullptr;
+
+        if (previous != nullptr)
+        {
+            auto it = std::lower_bound(previous->cells.begin(), previous->cells.end(), cell, positionLess);
+            if (it != previous->cells.end() && samePosition(it->position, cell.position))
+                known = &*it;
+        }
+
+        if (known != nullptr && known->lotheader.size == cell.lotheader.size && known->lotheader.mtime == cell.lotheader.mtime)
+            cell.lotheader.hash = known->lotheader.hash;
+        else
+            stale.push_back({ i, false });
+
+        if (known != nullptr && known->lotpack.size == cell.lotpack.size && known->lotpack.mtime == cell.lotpack.mtime)
+            cell.lotpack.hash = known->lotpack.hash;
+        else
+            stale.push_back({ i, true });
+    }
+
+    hashFiles(manifest, stale, threads);
+
+    return manifest;
+}
+
+MapManifest MapManifest::load(const std::string &mapDirectory, size_t threads)
+{
+    std::string path = manifestPath(mapDirectory);
+    std::optional<MapManifest> cached = read(path, mapDirectory);
+
+    MapManifest manifest;
+    bool changed = true;
+
+    if (cached && cached->directoryMtime == toStamp(fs::last_write_time(mapDirectory)))
+    {
+        manifest = std::move(*cached);
+        changed = manifest.refresh(threads);
+    }
+    else
+    {
+        manifest = scan(mapDirectory, cached ? &*cached : nullptr, threads);
+    }
+
+    if (changed)
+    {
+        // the manifest is only a cache, a read-only game directory must not prevent loading the map
+        try
+        {
+            manifest.save(path);
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+
+    return manifest;
+}
+
+std::optional<MapManifest> MapManifest::read(const std::string &path, const std::string &mapDirectory)
+{
+    if (!fs::is_regular_file(path))
+        return std::nullopt;
+
+    try
+    {
+        BytesBuffer buffer = FileReader::read(path);
+        BinaryCursor cursor(buffer);
+
+        if (cursor.readChars(4) != MAGIC || static_cast<uint32_t>(cursor.readInt32()) != VERSION)
+            return std::nullopt;
+
+        MapManifest manifest;
+        manifest.mapDirectory = mapDirectory;
+        manifest.directoryMtime = cursor.readInt64();
+
+        uint32_t cellsCount = cursor.readInt32();
+        if (cursor.remaining() != static_cast<size_t>(cellsCount) * CELL_SIZE)
+            return std::nullopt;
+
+        manifest.cells.resize(cellsCount);
+
+        for (Cell &cell : manifest.cells)
+        {
+            cell.position.x = cursor.readInt32();
+            cell.position.y = cursor.readInt32();
+            readStamp(cursor, cell.lotheader);
+            readStamp(cursor, cell.lotpack);
+        }
+
+        return manifest;
+    }
+    catch (const std::runtime_error &)
+    {
+        return std::nullopt;
+    }
+}
+
+std::string MapManifest::manifestPath(const std::string &mapDirectory)
+{
+    fs::path directory(mapDirectory);
+
+    // "maps/name/" has an empty filename
+    if (!directory.has_filename())
+        directory = directory.parent_path();
+
+    return directory.string() + std::string(EXTENSION);
+}
+
+bool MapManifest::refresh(size_t threads)
+{
+    StaleFiles stale;
+
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+        if (restat(fs::directory_entry(lotheaderPath(cells[i])), cells[i].lotheader))
+            stale.push_back({ i, false });
+
+        if (restat(fs::directory_entry(lotpackPath(cells[i])), cells[i].lotpack))
+            stale.push_back({ i, true });
+    }
+
+    hashFiles(*this, stale, threads);
+
+    return !stale.empty();
+}
+
+std::string MapManifest::lotheaderPath(const Cell &cell) const
+{
+    return mapDirectory + "/" + std::to_string(cell.position.x) + "_" + std::to_string(cell.position.y) + std::string(constants::LOTHEADER_EXT);
+}
+
+std::string MapManifest::lotpackPath(const Cell &cell) const
+{
+    return mapDirectory + "/world_" + std::to_string(cell.position.x) + "_" + std::to_string(cell.position.y) + std::string(constants::LOTPACK_EXT);
+}
+
+size_t MapManifest::serializedSize() const
+{
+    return HEADER_SIZE + cells.size() * CELL_SIZE;
+}
+
+BytesBuffer MapManifest::write() const
+{
+    BinaryWriter writer(serializedSize());
+
+    writer.writeChars(MAGIC);
+    writer.writeInt32(VERSION);
+    writer.writeInt64(directoryMtime);
+    writer.writeInt32(static_cast<int32_t>(cells.size()));
+
+    for (const Cell &cell : cells)
+    {
+        writer.writeInt32(cell.position.x);
+        writer.writeInt32(cell.position.y);
+        writeStamp(writer, cell.lotheader);
+        writeStamp(writer, cell.lotpack);
+    }
+
+    return writer.finish();
+}
+
+void MapManifest::save(const std::string &path) const
+{
+    FileReader::save(write(), path);
+}
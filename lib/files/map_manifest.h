@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "math/fingerprint.h"
+#include "math/vector2i.h"
+#include "types.h"
+
+// Cells of a map directory with the size, modification time and content
+// hash of their files. It is cached next to the map directory
+// ("<map>.pzmm"): later runs only re-stat the known files, the directory is
+// listed again only when its own modification time changed.
+//
+// layout: "PZMM", version, directory mtime (int64), cells count, then one
+// Cell per lotheader/lotpack pair sorted by position.
+class MapManifest
+{
+public:
+    struct FileStamp
+    {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        Fingerprint::Hash128 hash;
+    };
+
+    struct Cell
+    {
+        Vector2i position;
+        FileStamp lotheader;
+        FileStamp lotpack;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 4 + 4 + 8 + 4;
+    static constexpr size_t CELL_SIZE = 2 * 4 + 2 * (8 + 8 + 16);
+
+    static constexpr std::string_view MAGIC = "PZMM";
+    static constexpr std::string_view EXTENSION = ".pzmm";
+
+    std::string mapDirectory;
+    int64_t directoryMtime = 0;
+    std::vector<Cell> cells;
+
+    // lists the directory, hashes of `previous` are reused for unchanged files
+    static MapManifest scan(const std::string &mapDirectory, const MapManifest *previous = nullptr, size_t threads = 0);
+
+    // cached manifest brought up to date, saved back when something changed
+    static MapManifest load(const std::string &mapDirectory, size_t threads = 0);
+
+    // nullopt when the file is missing or malformed
+    static std::optional<MapManifest> read(const std::string &path, const std::string &mapDirectory);
+
+    static std::string manifestPath(const std::string &mapDirectory);
+
+    // re-stats every file and rehashes the modified ones, returns true if any changed
+    bool refresh(size_t threads = 0);
+
+    std::string lotheaderPath(const Cell &cell) const;
+    std::string lotpackPath(const Cell &cell) const;
+
+    size_t serializedSize() const;
+    BytesBuffer write() const;
+    void save(const std::string &path) const;
+};
@@ -1,53 +1,89 @@
+#include <cstring>
 #include <filesystem>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 
 #include "exceptions.h"
-#include "io/binary_reader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_stream.h"
+#include "io/binary_writer.h"
+#include "io/endian.h"
 #include "io/file_reader.h"
 #include "math/math.h"
 #include "texturepack.h"
 #include "types.h"
 
-TexturePack TexturePack::read(const std::filesystem::path &path)
+TexturePack TexturePack::read(const std::filesystem::path &path, bool keepPng)
 {
-    return TexturePack::read(path.filename().string(), FileReader::read(path.string()));
+    MappedFile file = FileReader::map(path.string());
+
+    return TexturePack::read(path.filename().string(), file.view(), keepPng);
 }
 
-TexturePack TexturePack::read(const std::string &name, const BytesBuffer &buffer)
+TexturePack TexturePack::read(const std::string &name, BytesView buffer, bool keepPng)
 {
     TexturePack texturePack{};
-    size_t offset = 0;
+    BinaryCursor cursor(buffer);
 
     texturePack.name = name;
-    texturePack.magic = BinaryReader::read_n_chars(buffer, 4, offset);
-    texturePack.version = TexturePack::readVersion(buffer, texturePack.magic, offset);
-    texturePack.pages = TexturePack::readPages(buffer, texturePack.version, offset);
+    texturePack.magic = cursor.readChars(4);
+    texturePack.version = TexturePack::readVersion(cursor, texturePack.magic);
+    texturePack.pages = TexturePack::readPages(cursor, texturePack.version, keepPng);
 
-    if (offset != buffer.size())
+    if (!cursor.eof())
     {
-        throw Exceptions::FileEndNotReached(offset, buffer.size());
+        throw Exceptions::FileEndNotReached(cursor.tell(), cursor.size());
     }
 
     return texturePack;
 }
 
-int32_t TexturePack::readVersion(const BytesBuffer &buffer, std::string magic, size_t &offset)
+int32_t TexturePack::readVersion(BinaryCursor &cursor, const std::string &magic)
 {
     if (magic == "PZPK")
     {
-        return BinaryReader::readInt32(buffer, offset);
+        return cursor.readInt32();
     }
     else
     {
-        offset = 0;
+        cursor.seek(0);
         return 0;
     }
 }
 
-std::vector<TexturePack::Page> TexturePack::readPages(const BytesBuffer &buffer, int32_t version, size_t &offset)
+template <typename Reader>
+std::vector<TexturePack::Texture> TexturePack::readTextures(Reader &reader, uint32_t &hasAlpha)
 {
-    int32_t pagesCount = BinaryReader::readInt32(buffer, offset);
+    int32_t texturesCount = reader.readInt32();
+    std::vector<Texture> textures(texturesCount);
+
+    hasAlpha = reader.readInt32();
+
+    for (int i = 0; i < texturesCount; i++)
+    {
+        Texture texture{};
+
+        texture.name = reader.readStringWithLength();
+        texture.hashcode = Math::hashFnv1a(texture.name);
+        texture.x = reader.readInt32();
+        texture.y = reader.readInt32();
+        texture.width = reader.readInt32();
+        texture.height = reader.readInt32();
+        texture.ox = reader.readInt32();
+        texture.oy = reader.readInt32();
+        texture.ow = reader.readInt32();
+        texture.oh = reader.readInt32();
+
+        textures[i] = texture;
+    }
+
+    return textures;
+}
+
+std::vector<TexturePack::Page> TexturePack::readPages(BinaryCursor &cursor, int32_t version, bool keepPng)
+{
+    int32_t pagesCount = cursor.readInt32();
     std::vector<Page> pages(pagesCount);
 
     for (int i = 0; i < pagesCount; i++)
@@ -55,66 +91,208 @@ std::vector<TexturePack::Page> TexturePack::readPages(const BytesBuffer &buffer,
         Page page{};
 
         page.version = version;
-        page.name = BinaryReader::readStringWithLength(buffer, offset);
-        page.textures = TexturePack::readTextures(buffer, offset);
-        page.image = TexturePack::readPNG(buffer, version, offset);
+        page.name = cursor.readStringWithLength();
+        page.textures = TexturePack::readTextures(cursor, page.hasAlpha);
+
+        BytesView png = TexturePack::readPNG(cursor, version);
+        if (!page.image.loadFromMemory(png.data(), png.size()))
+        {
+            throw std::runtime_error("failed loading texture.");
+        }
+
+        if (keepPng)
+        {
+            page.png.assign(png.begin(), png.end());
+        }
 
-        pages[i] = page;
+        pages[i] = std::move(page);
     }
 
     return pages;
 }
 
-sf::Image TexturePack::readPNG(const BytesBuffer &buffer, int32_t version, size_t &offset)
+BytesView TexturePack::readPNG(BinaryCursor &cursor, int32_t version)
 {
-    BytesBuffer png;
+    BytesView png;
 
     if (version == 0)
     {
-        png = BinaryReader::readUntil(buffer, { 0xEF, 0xBE, 0xAD, 0xDE }, offset);
+        png = cursor.readUntil(PNG_TERMINATOR);
     }
     else if (version == 1)
     {
-        png = BinaryReader::readBytesWithLength(buffer, offset);
+        png = cursor.readBytesWithLength();
     }
     else
     {
         throw std::runtime_error("Unsupported texturepack version: " + std::to_string(version));
     }
 
-    sf::Image image;
-    if (!image.loadFromMemory(png.data(), png.size()))
+    return png;
+}
+
+
+TexturePack TexturePack::stream(const std::filesystem::path &path, const PageConsumer &onPage, size_t chunkSize)
+{
+    TexturePack texturePack{};
+    BinaryStream stream(path.string(), chunkSize);
+
+    texturePack.name = path.filename().string();
+    texturePack.magic = stream.readChars(4);
+
+    int32_t pagesCount;
+
+    if (texturePack.magic == "PZPK")
+    {
+        texturePack.version = stream.readInt32();
+        pagesCount = stream.readInt32();
+    }
+    else
+    {
+        // version 0 has no header, the 4 bytes already read are the pages count
+        uint32_t value;
+        std::memcpy(&value, texturePack.magic.data(), 4);
+
+        texturePack.version = 0;
+        pagesCount = static_cast<int32_t>(Endian::toLittle(value));
+    }
+
+    if (texturePack.version > 1)
+    {
+        throw std::runtime_error("Unsupported texturepack version: " + std::to_string(texturePack.version));
+    }
+
+    Page page{};
+    page.version = texturePack.version;
+
+    for (int i = 0; i < pagesCount; i++)
+    {
+        page.name = stream.readStringWithLength();
+        page.textures = TexturePack::readTextures(stream, page.hasAlpha);
+
+        if (texturePack.version == 0)
+        {
+            stream.readUntil(PNG_TERMINATOR, page.png);
+        }
+        else
+        {
+            stream.readBytesWithLength(page.png);
+        }
+
+        onPage(page);
+    }
+
+    if (!stream.eof())
     {
-        throw std::runtime_error("failed loading texture.");
+        throw Exceptions::FileEndNotReached(stream.tell(), std::filesystem::file_size(path));
     }
 
-    return image;
+    return texturePack;
 }
 
-std::vector<TexturePack::Texture> TexturePack::readTextures(const BytesBuffer &buffer, size_t &offset)
+std::vector<BytesBuffer> TexturePack::encodeMissingPNGs() const
 {
-    int32_t texturesCount = BinaryReader::readInt32(buffer, offset);
-    std::vector<Texture> textures(texturesCount);
+    std::vector<BytesBuffer> encoded(pages.size());
 
-    bool hasAlpha = BinaryReader::readInt32(buffer, offset);
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        if (!pages[i].png.empty())
+            continue;
 
-    for (int i = 0; i < texturesCount; i++)
+        std::optional<BytesBuffer> png = pages[i].image.saveToMemory("png");
+        if (!png)
+        {
+            throw std::runtime_error("failed encoding texture: " + pages[i].name);
+        }
+
+        encoded[i] = std::move(*png);
+    }
+
+    return encoded;
+}
+
+size_t TexturePack::serializedSize() const
+{
+    return serializedSize(encodeMissingPNGs());
+}
+
+size_t TexturePack::serializedSize(const std::vector<BytesBuffer> &encoded) const
+{
+    size_t size = (version == 1 ? magic.size() + 4 : 0) + 4;
+
+    for (size_t i = 0; i < pages.size(); i++)
     {
-        Texture texture{};
+        const Page &page = pages[i];
+        size += 4 + page.name.size() + 4 + 4;
 
-        texture.name = BinaryReader::readStringWithLength(buffer, offset);
-        texture.hashcode = Math::hashFnv1a(texture.name);
-        texture.x = BinaryReader::readInt32(buffer, offset);
-        texture.y = BinaryReader::readInt32(buffer, offset);
-        texture.width = BinaryReader::readInt32(buffer, offset);
-        texture.height = BinaryReader::readInt32(buffer, offset);
-        texture.ox = BinaryReader::readInt32(buffer, offset);
-        texture.oy = BinaryReader::readInt32(buffer, offset);
-        texture.ow = BinaryReader::readInt32(buffer, offset);
-        texture.oh = BinaryReader::readInt32(buffer, offset);
+        for (const Texture &texture : page.textures)
+        {
+            size += 4 + texture.name.size() + 8 * 4;
+        }
 
-        textures[i] = texture;
+        // length prefix in version 1, terminator in version 0
+        size += pagePNG(page, encoded[i]).size() + 4;
     }
 
-    return textures;
+    return size;
+}
+
+BytesBuffer TexturePack::write() const
+{
+    if (version > 1)
+    {
+        throw std::runtime_error("Unsupported texturepack version: " + std::to_string(version));
+    }
+
+    // only pages without a kept png are encoded, once, before sizing the output
+    std::vector<BytesBuffer> encoded = encodeMissingPNGs();
+
+    BinaryWriter writer(serializedSize(encoded));
+
+    if (version == 1)
+    {
+        writer.writeChars(magic);
+        writer.writeInt32(version);
+    }
+
+    writer.writeInt32(static_cast<int32_t>(pages.size()));
+
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        const Page &page = pages[i];
+
+        writer.writeStringWithLength(page.name);
+        writer.writeInt32(static_cast<int32_t>(page.textures.size()));
+        writer.writeInt32(page.hasAlpha);
+
+        for (const Texture &texture : page.textures)
+        {
+            writer.writeStringWithLength(texture.name);
+            writer.writeInt32(texture.x);
+            writer.writeInt32(texture.y);
+            writer.writeInt32(texture.width);
+            writer.writeInt32(texture.height);
+            writer.writeInt32(texture.ox);
+            writer.writeInt32(texture.oy);
+            writer.writeInt32(texture.ow);
+            writer.writeInt32(texture.oh);
+        }
+
+        if (version == 1)
+        {
+            writer.writeBytesWithLength(pagePNG(page, encoded[i]));
+        }
+        else
+        {
+            writer.writeBytes(pagePNG(page, encoded[i]));
+            writer.writeBytes(PNG_TERMINATOR);
+        }
+    }
+
+    return writer.finish();
+}
+
+void TexturePack::save(const std::string &filename) const
+{
+    FileReader::save(write(), filename);
 }
@@ -3,9 +3,11 @@
 #include <SFML/Graphics/Image.hpp>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "io/binary_cursor.h"
 #include "types.h"
 
 class TexturePack
@@ -32,6 +34,7 @@ public:
         uint32_t hasAlpha;
         std::vector<Texture> textures;
         sf::Image image;
+        BytesBuffer png; // encoded image as stored in the file, only kept on request
     };
 
     std::string name;
@@ -41,10 +44,37 @@ public:
 
     TexturePack() = default;
 
-    static TexturePack read(const std::filesystem::path &path);
-    static TexturePack read(const std::string &name, const BytesBuffer &buffer);
-    static int32_t readVersion(const BytesBuffer &buffer, std::string magic, size_t &offset);
-    static sf::Image readPNG(const BytesBuffer &buffer, int32_t version, size_t &offset);
-    static std::vector<Page> readPages(const BytesBuffer &buffer, int32_t version, size_t &offset);
-    static std::vector<Texture> readTextures(const BytesBuffer &buffer, size_t &offset);
+    static TexturePack read(const std::filesystem::path &path, bool keepPng = false);
+    static TexturePack read(const std::string &name, BytesView buffer, bool keepPng = false);
+    static int32_t readVersion(BinaryCursor &cursor, const std::string &magic);
+    static BytesView readPNG(BinaryCursor &cursor, int32_t version);
+    static std::vector<Page> readPages(BinaryCursor &cursor, int32_t version, bool keepPng);
+
+    // Page as delivered to stream consumers: png holds the encoded payload and
+    // image is left empty, decoding is up to the consumer. The page is reused
+    // for the next one once the consumer returns.
+    using PageConsumer = std::function<void(const Page &page)>;
+
+    // reads the pack chunk by chunk, one page at a time, the returned pack has no pages
+    static TexturePack stream(const std::filesystem::path &path, const PageConsumer &onPage, size_t chunkSize = 64 * 1024);
+
+    size_t serializedSize() const;
+    BytesBuffer write() const;
+    void save(const std::string &filename) const;
+
+private:
+    static constexpr uint8_t PNG_TERMINATOR[] = { 0xEF, 0xBE, 0xAD, 0xDE };
+
+    // pages without a kept png are encoded from their image, the others are
+    // written from page.png as is: encoded[i] stays empty for them
+    std::vector<BytesBuffer> encodeMissingPNGs() const;
+    size_t serializedSize(const std::vector<BytesBuffer> &encoded) const;
+
+    static inline BytesView pagePNG(const Page &page, const BytesBuffer &encoded)
+    {
+        return page.png.empty() ? BytesView(encoded) : BytesView(page.png);
+    }
+
+    template <typename Reader>
+    static std::vector<Texture> readTextures(Reader &reader, uint32_t &hasAlpha);
 };
@@ -1,48 +1,51 @@
 #include <fmt/format.h>
 
 #include "exceptions.h"
-#include "io/binary_reader.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
 #include "io/file_reader.h"
 #include "tiledefinition.h"
 
 TileDefinition TileDefinition::read(const std::filesystem::path &path)
 {
-    return TileDefinition::read(path.filename().string(), FileReader::read(path.string()));
+    MappedFile file = FileReader::map(path.string());
+
+    return TileDefinition::read(path.filename().string(), file.view());
 }
 
-TileDefinition TileDefinition::read(const std::string &name, const BytesBuffer &buffer)
+TileDefinition TileDefinition::read(const std::string &name, BytesView buffer)
 {
     TileDefinition tileDefinition{};
-    size_t offset = 0;
+    BinaryCursor cursor(buffer);
 
     tileDefinition.name = name;
-    tileDefinition.magic = BinaryReader::read_n_chars(buffer, 4, offset);
-    tileDefinition.version = BinaryReader::readInt32(buffer, offset);
-    tileDefinition.tileSheets = TileDefinition::readTileSheets(buffer, offset);
+    tileDefinition.magic = cursor.readChars(4);
+    tileDefinition.version = cursor.readInt32();
+    tileDefinition.tileSheets = TileDefinition::readTileSheets(cursor);
 
-    if (offset != buffer.size())
+    if (!cursor.eof())
     {
-        throw Exceptions::FileEndNotReached(offset, buffer.size());
+        throw Exceptions::FileEndNotReached(cursor.tell(), cursor.size());
     }
 
     return tileDefinition;
 }
 
-std::vector<TileDefinition::TileSheet> TileDefinition::readTileSheets(const BytesBuffer &buffer, size_t &offset)
+std::vector<TileDefinition::TileSheet> TileDefinition::readTileSheets(BinaryCursor &cursor)
 {
-    int32_t tileSheetsCount = BinaryReader::readInt32(buffer, offset);
+    int32_t tileSheetsCount = cursor.readInt32();
     std::vector<TileSheet> tileSheets(tileSheetsCount);
 
     for (int i = 0; i < tileSheetsCount; i++)
     {
         TileSheet tileSheet{};
 
-        tileSheet.name = BinaryReader::readLineTrimmed(buffer, offset);
-        tileSheet.imageName = BinaryReader::readLineTrimmed(buffer, offset);
-        tileSheet.tileWidth = BinaryReader::readInt32(buffer, offset);
-        tileSheet.tileHeight = BinaryReader::readInt32(buffer, offset);
-        tileSheet.number = BinaryReader::readInt32(buffer, offset);
-        tileSheet.tilesCount = BinaryReader::readInt32(buffer, offset);
+        tileSheet.name = cursor.readLine();
+        tileSheet.imageName = cursor.readLine();
+        tileSheet.tileWidth = cursor.readInt32();
+        tileSheet.tileHeight = cursor.readInt32();
+        tileSheet.number = cursor.readInt32();
+        tileSheet.tilesCount = cursor.readInt32();
         tileSheet.tileDatas = std::vector<TileData>(tileSheet.tilesCount);
 
         for (int j = 0; j < tileSheet.tilesCount; j++)
@@ -51,7 +54,7 @@ std::vector<TileDefinition::TileSheet> TileDefinition::readTileSheets(const Byte
 
             tileData.spriteID = TileDefinition::generateSpriteID();
             tileData.name = tileSheet.name + "_" + std::to_string(j);
-            tileData.properties = TileDefinition::readProperties(buffer, offset);
+            tileData.properties = TileDefinition::readProperties(cursor);
 
             tileSheet.tileDatas[j] = tileData;
         }
@@ -62,17 +65,15 @@ std::vector<TileDefinition::TileSheet> TileDefinition::readTileSheets(const Byte
     return tileSheets;
 }
 
-std::unordered_map<std::string, std::string> TileDefinition::readProperties(const BytesBuffer &buffer, size_t &offset)
+std::vector<TileDefinition::Property> TileDefinition::readProperties(BinaryCursor &cursor)
 {
-    uint32_t propertiesCount = BinaryReader::readInt32(buffer, offset);
-    std::unordered_map<std::string, std::string> properties(propertiesCount);
+    uint32_t propertiesCount = cursor.readInt32();
+    std::vector<Property> properties(propertiesCount);
 
     for (uint32_t i = 0; i < propertiesCount; i++)
     {
-        std::string name = BinaryReader::readLineTrimmed(buffer, offset);
-        std::string value = BinaryReader::readLineTrimmed(buffer, offset);
-
-        properties[name] = value;
+        properties[i].name = cursor.readLine();
+        properties[i].value = cursor.readLine();
     }
 
     return properties;
@@ -81,4 +82,63 @@ std::unordered_map<std::string, std::string> TileDefinition::readProperties(cons
 int32_t TileDefinition::generateSpriteID()
 {
     return -1;
-}
\ No newline at end of file
+}
+
+size_t TileDefinition::serializedSize() const
+{
+    size_t size = magic.size() + 4 + 4;
+
+    for (const TileSheet &tileSheet : tileSheets)
+    {
+        size += tileSheet.name.size() + 1 + tileSheet.imageName.size() + 1 + 4 * 4;
+
+        for (const TileData &tileData : tileSheet.tileDatas)
+        {
+            size += 4;
+
+            for (const Property &property : tileData.properties)
+            {
+                size += property.name.size() + 1 + property.value.size() + 1;
+            }
+        }
+    }
+
+    return size;
+}
+
+BytesBuffer TileDefinition::write() const
+{
+    BinaryWriter writer(serializedSize());
+
+    writer.writeChars(magic);
+    writer.writeInt32(version);
+    writer.writeInt32(static_cast<int32_t>(tileSheets.size()));
+
+    for (const TileSheet &tileSheet : tileSheets)
+    {
+        writer.writeLine(tileSheet.name);
+        writer.writeLine(tileSheet.imageName);
+        writer.writeInt32(tileSheet.tileWidth);
+        writer.writeInt32(tileSheet.tileHeight);
+        writer.writeInt32(tileSheet.number);
+        writer.writeInt32(static_cast<int32_t>(tileSheet.tileDatas.size()));
+
+        for (const TileData &tileData : tileSheet.tileDatas)
+        {
+            writer.writeInt32(static_cast<int32_t>(tileData.properties.size()));
+
+            for (const Property &property : tileData.properties)
+            {
+                writer.writeLine(property.name);
+                writer.writeLine(property.value);
+            }
+        }
+    }
+
+    return writer.finish();
+}
+
+void TileDefinition::save(const std::string &filename) const
+{
+    FileReader::save(write(), filename);
+}
@@ -1,20 +1,38 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 
+#include "io/binary_cursor.h"
 #include "types.h"
 
 class TileDefinition
 {
 public:
+    struct Property
+    {
+        std::string name;
+        std::string value;
+    };
+
     struct TileData
     {
         std::string name;
         int32_t spriteID;
-        std::unordered_map<std::string, std::string> properties;
+        std::vector<Property> properties; // file order, kept for serialization
+
+        const std::string *getProperty(std::string_view propertyName) const
+        {
+            for (auto it = properties.rbegin(); it != properties.rend(); it++)
+            {
+                if (it->name == propertyName)
+                    return &it->value;
+            }
+
+            return nullptr;
+        }
     };
 
     struct TileSheet
@@ -36,8 +54,12 @@ public:
     TileDefinition() = default;
 
     static TileDefinition read(const std::filesystem::path &path);
-    static TileDefinition read(const std::string &name, const BytesBuffer &buffer);
-    static std::vector<TileSheet> readTileSheets(const BytesBuffer &buffer, size_t &offset);
-    static std::unordered_map<std::string, std::string> readProperties(const BytesBuffer &buffer, size_t &offset);
+    static TileDefinition read(const std::string &name, BytesView buffer);
+    static std::vector<TileSheet> readTileSheets(BinaryCursor &cursor);
+    static std::vector<Property> readProperties(BinaryCursor &cursor);
     static int32_t generateSpriteID();
+
+    size_t serializedSize() const;
+    BytesBuffer write() const;
+    void save(const std::string &filename) const;
 };
\ No newline at end of file
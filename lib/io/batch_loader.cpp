@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "batch_loader.h"
+#include "io/file_reader.h"
+
+BatchLoader::BatchLoader(size_t workers, size_t _maxInFlight)
+{
+    workersCount = workers > 0 ? workers : std::max(1u, std::thread::hardware_concurrency());
+    maxInFlight = std::max<size_t>(1, _maxInFlight);
+}
+
+void BatchLoader::load(const std::vector<std::string> &paths, const Callback &onLoaded) const
+{
+    struct Result
+    {
+        size_t index;
+        BytesBuffer buffer;
+        std::exception_ptr error;
+    };
+
+    std::mutex mutex;
+    std::condition_variable resultReady;
+    std::condition_variable slotReleased;
+    std::deque<Result> results;
+
+    size_t nextIndex = 0;
+    size_t inFlight = 0;
+    bool cancelled = false;
+
+    auto worker = [&]()
+    {
+        while (true)
+        {
+            size_t index;
+            {
+                std::unique_lock lock(mutex);
+                slotReleased.wait(lock, [&]() { return cancelled || nextIndex == paths.size() || inFlight < maxInFlight; });
+
+                if (cancelled || nextIndex == paths.size())
+                    return;
+
+                index = nextIndex++;
+                inFlight++;
+            }
+
+            Result result{ index, {}, nullptr };
+            try
+            {
+                result.buffer = FileReader::readPositional(paths[index]);
+            }
+            catch (...)
+            {
+                result.error = std::current_exception();
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                results.push_back(std::move(result));
+            }
+            resultReady.notify_one();
+        }
+    };
+
+    size_t threadsCount = std::min(workersCount, paths.size());
+    std::vector<std::thread> workers;
+    workers.reserve(threadsCount);
+
+    for (size_t i = 0; i < threadsCount; i++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    auto stop = [&]()
+    {
+        {
+            std::lock_guard lock(mutex);
+            cancelled = true;
+        }
+        slotReleased.notify_all();
+
+        for (std::thread &thread : workers)
+        {
+            thread.join();
+        }
+    };
+
+    try
+    {
+        for (size_t consumed = 0; consumed < paths.size(); consumed++)
+        {
+            Result result;
+            {
+                std::unique_lock lock(mutex);
+                resultReady.wait(lock, [&]() { return !results.empty(); });
+
+                result = std::move(results.front());
+                results.pop_front();
+                inFlight--;
+            }
+            slotReleased.notify_one();
+
+            if (result.error)
+            {
+                std::rethrow_exception(result.error);
+            }
+
+            onLoaded(result.index, std::move(result.buffer));
+        }
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+
+    stop();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Reads a list of files on a pool of worker threads and hands every buffer
+// to a callback running on the calling thread, in completion order.
+// Parsing a file therefore overlaps with the reads still in flight, while
+// the callback itself never needs to be thread safe.
+class BatchLoader
+{
+public:
+    using Callback = std::function<void(size_t index, BytesBuffer &&buffer)>;
+
+private:
+    size_t workersCount;
+    size_t maxInFlight;
+
+public:
+    // workers = 0 picks the hardware concurrency, maxInFlight bounds the
+    // number of buffers loaded but not yet consumed by the callback
+    explicit BatchLoader(size_t workers = 0, size_t maxInFlight = 64);
+
+    // index is the position of the file in paths, the first read or callback
+    // error stops the batch and is rethrown once the workers are joined
+    void load(const std::vector<std::string> &paths, const Callback &onLoaded) const;
+};
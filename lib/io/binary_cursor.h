@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "io/byte_scanner.h"
+#include "io/endian.h"
+#include "types.h"
+
+// Bounds checking policies: unchecked reads are only meant for buffers whose
+// structure has been validated beforehand (see LotHeader::validate).
+struct CheckedPolicy
+{
+    static constexpr bool checkBounds = true;
+};
+
+struct UncheckedPolicy
+{
+    static constexpr bool checkBounds = false;
+};
+
+// Forward-only reader over a borrowed byte buffer.
+// Strings and byte ranges are returned as views into the buffer: they stay
+// valid as long as the underlying storage (BytesBuffer, MappedFile...) does.
+template <typename Policy>
+class BasicBinaryCursor
+{
+private:
+    BytesView buffer;
+    size_t offset = 0;
+
+    inline void require(size_t size) const
+    {
+        if constexpr (Policy::checkBounds)
+        {
+            if (size > buffer.size() - offset)
+                throw std::runtime_error("buffer is too small");
+        }
+    }
+
+public:
+    BasicBinaryCursor(BytesView _buffer, size_t _offset = 0) : buffer(_buffer)
+    {
+        seek(_offset);
+    }
+
+    inline BytesView data() const { return buffer; }
+    inline size_t tell() const { return offset; }
+    inline size_t size() const { return buffer.size(); }
+    inline size_t remaining() const { return buffer.size() - offset; }
+    inline bool eof() const { return offset == buffer.size(); }
+
+    inline void seek(size_t position)
+    {
+        if constexpr (Policy::checkBounds)
+        {
+            if (position > buffer.size())
+                throw std::runtime_error("offset out of buffer bounds");
+        }
+
+        offset = position;
+    }
+
+    inline void skip(size_t size)
+    {
+        require(size);
+        offset += size;
+    }
+
+    inline int32_t readInt32()
+    {
+        require(4);
+
+        uint32_t value;
+        std::memcpy(&value, buffer.data() + offset, 4);
+        offset += 4;
+
+        return static_cast<int32_t>(Endian::toLittle(value));
+    }
+
+    inline int64_t readInt64()
+    {
+        require(8);
+
+        uint64_t value;
+        std::memcpy(&value, buffer.data() + offset, 8);
+        offset += 8;
+
+        return static_cast<int64_t>(Endian::toLittle(value));
+    }
+
+    // Decodes output.size() elements made only of 32 bits little-endian fields
+    // (int32_t, uint32_t or plain structs of those) with a single bounds check.
+    template <typename T, size_t Extent>
+    inline void readInt32Array(std::span<T, Extent> output)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0);
+
+        size_t size = output.size_bytes();
+        require(size);
+
+        std::memcpy(output.data(), buffer.data() + offset, size);
+        offset += size;
+
+        Endian::toLittle(reinterpret_cast<uint32_t *>(output.data()), size / 4);
+    }
+
+    inline std::string_view readChars(size_t size)
+    {
+        require(size);
+
+        std::string_view result(reinterpret_cast<const char *>(buffer.data() + offset), size);
+        offset += size;
+        return result;
+    }
+
+    inline BytesView readExact(size_t size)
+    {
+        require(size);
+
+        BytesView result = buffer.subspan(offset, size);
+        offset += size;
+        return result;
+    }
+
+    inline std::string_view readStringWithLength()
+    {
+        return readChars(static_cast<uint32_t>(readInt32()));
+    }
+
+    inline BytesView readBytesWithLength()
+    {
+        return readExact(static_cast<uint32_t>(readInt32()));
+    }
+
+    // returns the line without its '\n' terminator
+    inline std::string_view readLine()
+    {
+        size_t end = ByteScanner::find(buffer, '\n', offset);
+
+        if constexpr (Policy::checkBounds)
+        {
+            if (end == ByteScanner::npos)
+                throw std::runtime_error("line terminator not found");
+        }
+
+        std::string_view line(reinterpret_cast<const char *>(buffer.data() + offset), end - offset);
+        offset = end + 1;
+        return line;
+    }
+
+    // returns the bytes preceding the pattern, the cursor is moved after the pattern
+    inline BytesView readUntil(BytesView pattern)
+    {
+        size_t end = ByteScanner::find(buffer, pattern, offset);
+
+        if constexpr (Policy::checkBounds)
+        {
+            if (end == ByteScanner::npos)
+                throw std::runtime_error("Pattern not found.");
+        }
+
+        BytesView result = buffer.subspan(offset, end - offset);
+        offset = end + pattern.size();
+        return result;
+    }
+};
+
+using BinaryCursor = BasicBinaryCursor<CheckedPolicy>;
+using UncheckedBinaryCursor = BasicBinaryCursor<UncheckedPolicy>;
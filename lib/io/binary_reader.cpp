@@ -1,101 +1,69 @@
-#include <algorithm>
 #include <cstdint>
 #include <vector>
 
+#include "binary_cursor.h"
 #include "binary_reader.h"
 #include "exceptions.h"
 
-std::string BinaryReader::read_n_chars(const BytesBuffer &buffer, size_t size, size_t &offset)
+std::string BinaryReader::read_n_chars(BytesView buffer, size_t size, size_t &offset)
 {
-    if (offset + size > buffer.size())
-        throw std::runtime_error("buffer is too small");
-
-    std::string result(reinterpret_cast<const char *>(buffer.data() + offset), size);
-    offset += size;
+    BinaryCursor cursor(buffer, offset);
+    std::string result(cursor.readChars(size));
+    offset = cursor.tell();
     return result;
 }
 
-int32_t BinaryReader::readInt32(const BytesBuffer &buffer, size_t &offset)
+int32_t BinaryReader::readInt32(BytesView buffer, size_t &offset)
 {
-    if (offset + 4 > buffer.size())
-        throw std::runtime_error("buffer is too small");
-
-    uint32_t value;
-    std::memcpy(&value, buffer.data() + offset, 4);
-    offset += 4;
+    BinaryCursor cursor(buffer, offset);
+    int32_t value = cursor.readInt32();
+    offset = cursor.tell();
     return value;
 }
 
-std::string BinaryReader::readLineTrimmed(const BytesBuffer &buffer, size_t &offset)
+void BinaryReader::readInt32Array(BytesView buffer, std::span<int32_t> output, size_t &offset)
 {
-    for (size_t i = offset; i < buffer.size(); i++)
-    {
-        if (buffer[i] != '\n')
-            continue;
-
-        size_t size = i - offset;
-
-        std::string line(reinterpret_cast<const char *>(&buffer[offset]), size);
-        offset += size + 1;
-
-        return line;
-    }
-
-    throw std::runtime_error("line terminator not found");
+    BinaryCursor cursor(buffer, offset);
+    cursor.readInt32Array(output);
+    offset = cursor.tell();
 }
 
-std::string BinaryReader::readStringWithLength(const BytesBuffer &buffer, size_t &offset)
+std::string BinaryReader::readLineTrimmed(BytesView buffer, size_t &offset)
 {
-    int32_t size = readInt32(buffer, offset);
-
-    if (offset + size > buffer.size())
-        throw std::runtime_error("buffer too small");
-
-    std::string line(reinterpret_cast<const char *>(&buffer[offset]), size);
-    offset += size;
-
+    BinaryCursor cursor(buffer, offset);
+    std::string line(cursor.readLine());
+    offset = cursor.tell();
     return line;
 }
 
-BytesBuffer BinaryReader::readBytesWithLength(const BytesBuffer &buffer, size_t &offset)
+std::string BinaryReader::readStringWithLength(BytesView buffer, size_t &offset)
 {
-    int32_t size = readInt32(buffer, offset);
-
-    if (offset + size > buffer.size())
-        throw std::runtime_error("buffer too small");
-
-    BytesBuffer result(size);
-    std::memcpy(result.data(), buffer.data() + offset, size);
-    offset += size;
-
-    return result;
+    BinaryCursor cursor(buffer, offset);
+    std::string line(cursor.readStringWithLength());
+    offset = cursor.tell();
+    return line;
 }
 
-BytesBuffer BinaryReader::readExact(const BytesBuffer &buffer, uint32_t size, size_t &offset)
+BytesBuffer BinaryReader::readBytesWithLength(BytesView buffer, size_t &offset)
 {
-    if (offset + size > buffer.size())
-        throw std::runtime_error("buffer is too small");
-
-    BytesBuffer result(size);
-    std::memcpy(result.data(), buffer.data() + offset, size);
-    offset += size;
-
-    return result;
+    BinaryCursor cursor(buffer, offset);
+    BytesView bytes = cursor.readBytesWithLength();
+    offset = cursor.tell();
+    return BytesBuffer(bytes.begin(), bytes.end());
 }
 
-BytesBuffer BinaryReader::readUntil(const BytesBuffer &buffer, const BytesBuffer &pattern, size_t &offset)
+BytesBuffer BinaryReader::readExact(BytesView buffer, uint32_t size, size_t &offset)
 {
-    auto it = std::search(buffer.begin() + offset, buffer.end(), pattern.begin(), pattern.end());
-
-    if (it == buffer.end())
-    {
-        throw std::runtime_error("Pattern not found.");
-    }
-
-    std::size_t pos = std::distance(buffer.begin(), it);
-    std::vector<uint8_t> slice(buffer.begin() + offset, buffer.begin() + pos);
-
-    offset = pos + pattern.size();
+    BinaryCursor cursor(buffer, offset);
+    BytesView bytes = cursor.readExact(size);
+    offset = cursor.tell();
+    return BytesBuffer(bytes.begin(), bytes.end());
+}
 
-    return slice;
+BytesBuffer BinaryReader::readUntil(BytesView buffer, const BytesBuffer &pattern, size_t &offset)
+{
+    BinaryCursor cursor(buffer, offset);
+    BytesView bytes = cursor.readUntil(pattern);
+    offset = cursor.tell();
+    return BytesBuffer(bytes.begin(), bytes.end());
 }
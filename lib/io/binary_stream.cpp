@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "binary_stream.h"
+#include "io/byte_scanner.h"
+#include "io/endian.h"
+
+BinaryStream::BinaryStream(const std::string &_path, size_t chunkCapacity) :
+        file(_path, std::ios::binary), path(_path), chunk(std::max<size_t>(chunkCapacity, 16))
+{
+    if (!file)
+    {
+        throw std::runtime_error("Can't open file: " + path);
+    }
+}
+
+// moves the unread bytes to the front of the chunk and fills the rest from the file
+bool BinaryStream::refill()
+{
+    size_t unread = chunkSize - chunkOffset;
+    std::memmove(chunk.data(), chunk.data() + chunkOffset, unread);
+
+    chunkOffset = 0;
+    chunkSize = unread;
+
+    if (!file)
+        return false;
+
+    file.read(reinterpret_cast<char *>(chunk.data() + unread), chunk.size() - unread);
+    chunkSize += static_cast<size_t>(file.gcount());
+
+    return chunkSize > unread;
+}
+
+void BinaryStream::require(size_t size)
+{
+    while (chunkSize - chunkOffset < size)
+    {
+        if (!refill())
+            throw std::runtime_error("unexpected end of file: " + path);
+    }
+}
+
+bool BinaryStream::eof()
+{
+    return chunkOffset == chunkSize && !refill();
+}
+
+void BinaryStream::read(uint8_t *output, size_t size)
+{
+    while (size > 0)
+    {
+        if (chunkOffset == chunkSize && !refill())
+            throw std::runtime_error("unexpected end of file: " + path);
+
+        size_t count = std::min(size, chunkSize - chunkOffset);
+        std::memcpy(output, chunk.data() + chunkOffset, count);
+
+        chunkOffset += count;
+        position += count;
+        output += count;
+        size -= count;
+    }
+}
+
+int32_t BinaryStream::readInt32()
+{
+    require(4);
+
+    uint32_t value;
+    std::memcpy(&value, chunk.data() + chunkOffset, 4);
+    chunkOffset += 4;
+    position += 4;
+
+    return static_cast<int32_t>(Endian::toLittle(value));
+}
+
+std::string BinaryStream::readChars(size_t size)
+{
+    std::string result(size, '\0');
+    read(reinterpret_cast<uint8_t *>(result.data()), size);
+    return result;
+}
+
+std::string BinaryStream::readStringWithLength()
+{
+    return readChars(static_cast<uint32_t>(readInt32()));
+}
+
+void BinaryStream::readExact(size_t size, BytesBuffer &output)
+{
+    output.resize(size);
+    read(output.data(), size);
+}
+
+void BinaryStream::readBytesWithLength(BytesBuffer &output)
+{
+    readExact(static_cast<uint32_t>(readInt32()), output);
+}
+
+void BinaryStream::readUntil(BytesView pattern, BytesBuffer &output)
+{
+    output.clear();
+
+    while (true)
+    {
+        BytesView available(chunk.data() + chunkOffset, chunkSize - chunkOffset);
+        size_t found = ByteScanner::find(available, pattern);
+
+        if (found != ByteScanner::npos)
+        {
+            output.insert(output.end(), available.begin(), available.begin() + found);
+            chunkOffset += found + pattern.size();
+            position += found + pattern.size();
+            return;
+        }
+
+        // the last bytes may be the beginning of a pattern split across two chunks
+        size_t kept = std::min(available.size(), pattern.size() - 1);
+        size_t consumed = available.size() - kept;
+
+        output.insert(output.end(), available.begin(), available.begin() + consumed);
+        chunkOffset += consumed;
+        position += consumed;
+
+        if (!refill())
+            throw std::runtime_error("Pattern not found.");
+    }
+}
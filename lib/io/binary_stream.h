@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "types.h"
+
+// Forward-only reader over a file read in fixed size chunks.
+// Counterpart of BinaryCursor for files that should not be loaded whole:
+// memory use is the chunk plus whatever the caller asks to copy out.
+class BinaryStream
+{
+private:
+    std::ifstream file;
+    std::string path;
+
+    BytesBuffer chunk;
+    size_t chunkOffset = 0;
+    size_t chunkSize = 0;
+    size_t position = 0;
+
+    bool refill();
+    void require(size_t size);
+
+public:
+    explicit BinaryStream(const std::string &_path, size_t chunkCapacity = 64 * 1024);
+
+    inline size_t tell() const { return position; }
+    bool eof();
+
+    void read(uint8_t *output, size_t size);
+    int32_t readInt32();
+    std::string readChars(size_t size);
+    std::string readStringWithLength();
+
+    // the output buffers are overwritten, callers can reuse them to keep their capacity
+    void readExact(size_t size, BytesBuffer &output);
+    void readBytesWithLength(BytesBuffer &output);
+    void readUntil(BytesView pattern, BytesBuffer &output);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "io/endian.h"
+#include "types.h"
+
+// Serializes into a buffer allocated once with the exact output size.
+// Writers compute that size up front, so exceeding it or leaving bytes
+// unwritten means the size computation and the serialization disagree.
+class BinaryWriter
+{
+private:
+    BytesBuffer buffer;
+    size_t offset = 0;
+
+    inline uint8_t *reserve(size_t size)
+    {
+        if (size > buffer.size() - offset)
+            throw std::runtime_error("writer capacity exceeded");
+
+        uint8_t *output = buffer.data() + offset;
+        offset += size;
+        return output;
+    }
+
+public:
+    explicit BinaryWriter(size_t capacity) : buffer(capacity) {}
+
+    inline size_t tell() const { return offset; }
+    inline size_t capacity() const { return buffer.size(); }
+
+    inline void writeInt32(int32_t value)
+    {
+        uint32_t little = Endian::toLittle(static_cast<uint32_t>(value));
+        std::memcpy(reserve(4), &little, 4);
+    }
+
+    inline void writeInt64(int64_t value)
+    {
+        uint64_t little = Endian::toLittle(static_cast<uint64_t>(value));
+        std::memcpy(reserve(8), &little, 8);
+    }
+
+    // counterpart of BinaryCursor::readInt32Array
+    template <typename T, size_t Extent>
+    inline void writeInt32Array(std::span<T, Extent> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0);
+
+        uint8_t *output = reserve(values.size_bytes());
+        std::memcpy(output, values.data(), values.size_bytes());
+
+        Endian::toLittle(reinterpret_cast<uint32_t *>(output), values.size_bytes() / 4);
+    }
+
+    inline void writeBytes(BytesView bytes)
+    {
+        if (!bytes.empty())
+            std::memcpy(reserve(bytes.size()), bytes.data(), bytes.size());
+    }
+
+    inline void writeChars(std::string_view chars)
+    {
+        writeBytes(BytesView(reinterpret_cast<const uint8_t *>(chars.data()), chars.size()));
+    }
+
+    inline void writeLine(std::string_view line)
+    {
+        writeChars(line);
+        *reserve(1) = '\n';
+    }
+
+    inline void writeStringWithLength(std::string_view chars)
+    {
+        writeInt32(static_cast<int32_t>(chars.size()));
+        writeChars(chars);
+    }
+
+    inline void writeBytesWithLength(BytesView bytes)
+    {
+        writeInt32(static_cast<int32_t>(bytes.size()));
+        writeBytes(bytes);
+    }
+
+    inline void patchInt32(size_t position, int32_t value)
+    {
+        if (position > buffer.size() || 4 > buffer.size() - position)
+            throw std::runtime_error("patch out of buffer bounds");
+
+        uint32_t little = Endian::toLittle(static_cast<uint32_t>(value));
+        std::memcpy(buffer.data() + position, &little, 4);
+    }
+
+    inline BytesBuffer finish()
+    {
+        if (offset != buffer.size())
+            throw std::runtime_error("writer capacity not filled");
+
+        offset = 0;
+        return std::move(buffer);
+    }
+};
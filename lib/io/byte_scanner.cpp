@@ -0,0 +1,87 @@
+#include <bit>
+#include <cstring>
+
+#include "byte_scanner.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BYTE_SCANNER_SSE2
+#endif
+
+namespace
+{
+    // looks for a 4 bytes sentinel 16 positions at a time: each lane compares
+    // one byte of the sentinel against the input shifted by that byte index
+    size_t findSentinel4(BytesView buffer, const uint8_t *sentinel, size_t from)
+    {
+        const uint8_t *data = buffer.data();
+        size_t size = buffer.size();
+        size_t i = from;
+
+#ifdef BYTE_SCANNER_SSE2
+        const __m128i b0 = _mm_set1_epi8(static_cast<char>(sentinel[0]));
+        const __m128i b1 = _mm_set1_epi8(static_cast<char>(sentinel[1]));
+        const __m128i b2 = _mm_set1_epi8(static_cast<char>(sentinel[2]));
+        const __m128i b3 = _mm_set1_epi8(static_cast<char>(sentinel[3]));
+
+        for (; i + 16 + 3 <= size; i += 16)
+        {
+            __m128i m0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), b0);
+            __m128i m1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1)), b1);
+            __m128i m2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 2)), b2);
+            __m128i m3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 3)), b3);
+
+            __m128i match = _mm_and_si128(_mm_and_si128(m0, m1), _mm_and_si128(m2, m3));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+
+            if (mask != 0)
+            {
+                return i + std::countr_zero(mask);
+            }
+        }
+#endif
+
+        for (; i + 4 <= size; i++)
+        {
+            if (std::memcmp(data + i, sentinel, 4) == 0)
+                return i;
+        }
+
+        return ByteScanner::npos;
+    }
+}
+
+size_t ByteScanner::find(BytesView buffer, uint8_t value, size_t from)
+{
+    if (from >= buffer.size())
+        return npos;
+
+    const void *found = std::memchr(buffer.data() + from, value, buffer.size() - from);
+
+    if (found == nullptr)
+        return npos;
+
+    return static_cast<const uint8_t *>(found) - buffer.data();
+}
+
+size_t ByteScanner::find(BytesView buffer, BytesView pattern, size_t from)
+{
+    if (pattern.empty())
+        return from <= buffer.size() ? from : npos;
+
+    if (from >= buffer.size() || pattern.size() > buffer.size() - from)
+        return npos;
+
+    if (pattern.size() == 4)
+        return findSentinel4(buffer, pattern.data(), from);
+
+    size_t last = buffer.size() - pattern.size();
+
+    for (size_t i = find(buffer, pattern[0], from); i != npos && i <= last; i = find(buffer, pattern[0], i + 1))
+    {
+        if (std::memcmp(buffer.data() + i + 1, pattern.data() + 1, pattern.size() - 1) == 0)
+            return i;
+    }
+
+    return npos;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+// Delimiter search over raw buffers, used to split lines and find sentinels
+// without walking the data byte by byte.
+namespace ByteScanner
+{
+    constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t find(BytesView buffer, uint8_t value, size_t from = 0);
+    size_t find(BytesView buffer, BytesView pattern, size_t from = 0);
+}
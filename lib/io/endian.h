@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Game files are little-endian, values only need swapping on big-endian hosts.
+namespace Endian
+{
+    constexpr bool isNativeLittle = std::endian::native == std::endian::little;
+
+    inline uint32_t byteSwap(uint32_t value)
+    {
+        return (value >> 24) | ((value >> 8) & 0x0000FF00) | ((value << 8) & 0x00FF0000) | (value << 24);
+    }
+
+    inline uint64_t byteSwap(uint64_t value)
+    {
+        return (static_cast<uint64_t>(byteSwap(static_cast<uint32_t>(value))) << 32) | byteSwap(static_cast<uint32_t>(value >> 32));
+    }
+
+    inline uint32_t toLittle(uint32_t value)
+    {
+        if constexpr (isNativeLittle)
+            return value;
+
+        return byteSwap(value);
+    }
+
+    inline uint64_t toLittle(uint64_t value)
+    {
+        if constexpr (isNativeLittle)
+            return value;
+
+        return byteSwap(value);
+    }
+
+    inline void toLittle(uint32_t *words, size_t count)
+    {
+        if constexpr (isNativeLittle)
+            return;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            words[i] = byteSwap(words[i]);
+        }
+    }
+}
@@ -1,10 +1,23 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "file_reader.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 BytesBuffer FileReader::read(std::string path)
 {
     std::ifstream file(path, std::ios::binary | std::ios::ate);
@@ -25,6 +38,95 @@ BytesBuffer FileReader::read(std::string path)
     return buffer;
 }
 
+#ifdef _WIN32
+
+BytesBuffer FileReader::readPositional(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Can't open file: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Can't read file size: " + path);
+    }
+
+    BytesBuffer buffer(static_cast<size_t>(fileSize.QuadPart));
+    size_t offset = 0;
+
+    while (offset < buffer.size())
+    {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+
+        DWORD requested = static_cast<DWORD>(std::min<size_t>(buffer.size() - offset, 1u << 30));
+        DWORD read = 0;
+
+        if (!ReadFile(file, buffer.data() + offset, requested, &read, &overlapped) || read == 0)
+        {
+            CloseHandle(file);
+            throw std::runtime_error("Can't read file: " + path);
+        }
+
+        offset += read;
+    }
+
+    CloseHandle(file);
+    return buffer;
+}
+
+#else
+
+BytesBuffer FileReader::readPositional(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Can't open file: " + path);
+    }
+
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Can't read file size: " + path);
+    }
+
+    BytesBuffer buffer(static_cast<size_t>(fileStat.st_size));
+    size_t offset = 0;
+
+    while (offset < buffer.size())
+    {
+        ssize_t read = ::pread(fd, buffer.data() + offset, buffer.size() - offset, static_cast<off_t>(offset));
+
+        if (read < 0 && errno == EINTR)
+            continue;
+
+        if (read <= 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Can't read file: " + path);
+        }
+
+        offset += static_cast<size_t>(read);
+    }
+
+    ::close(fd);
+    return buffer;
+}
+
+#endif
+
+MappedFile FileReader::map(const std::string &path, MappedFile::AccessHint hint)
+{
+    return MappedFile(path, hint);
+}
+
 void FileReader::save(const BytesBuffer &buffer, std::string path)
 {
     std::ofstream file(path, std::ios::binary | std::ios::trunc);
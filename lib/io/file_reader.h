@@ -1,5 +1,6 @@
 #pragma once
 
+#include "io/mapped_file.h"
 #include "types.h"
 #include <string>
 
@@ -7,5 +8,11 @@
 namespace FileReader
 {
     BytesBuffer read(std::string path);
+
+    // whole file through positional reads (pread, ReadFile at an offset) into
+    // a buffer sized once from the file size: no shared file position nor
+    // stream buffering, meant for loader threads
+    BytesBuffer readPositional(const std::string &path);
+    MappedFile map(const std::string &path, MappedFile::AccessHint hint = MappedFile::AccessHint::Sequential);
     void save(const BytesBuffer &buffer, std::string path);
 }
\ No newline at end of file
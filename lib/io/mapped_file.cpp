@@ -0,0 +1,167 @@
+#include <stdexcept>
+#include <utility>
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path, AccessHint hint)
+{
+    DWORD flags = hint == AccessHint::Random ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Can't open file: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Can't read file size: " + path);
+    }
+
+    if (fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // the view keeps the mapping alive, both handles can be closed right away
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (mapping == nullptr)
+    {
+        throw std::runtime_error("Can't map file: " + path);
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (view == nullptr)
+    {
+        throw std::runtime_error("Can't map file: " + path);
+    }
+
+    mappedData = static_cast<const uint8_t *>(view);
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+}
+
+void MappedFile::release() noexcept
+{
+    if (mappedData != nullptr)
+    {
+        UnmapViewOfFile(mappedData);
+    }
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+void MappedFile::advise(AccessHint hint) const
+{
+    // access pattern is given to CreateFileA, there is no per-view equivalent of madvise
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path, AccessHint hint)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Can't open file: " + path);
+    }
+
+    struct stat fileStat;
+    if (::fstat(fd, &fileStat) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Can't read file size: " + path);
+    }
+
+    if (fileStat.st_size == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    void *view = ::mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (view == MAP_FAILED)
+    {
+        throw std::runtime_error("Can't map file: " + path);
+    }
+
+    mappedData = static_cast<const uint8_t *>(view);
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+
+    advise(hint);
+}
+
+void MappedFile::release() noexcept
+{
+    if (mappedData != nullptr)
+    {
+        ::munmap(const_cast<uint8_t *>(mappedData), mappedSize);
+    }
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+void MappedFile::advise(AccessHint hint) const
+{
+    if (mappedData == nullptr)
+        return;
+
+    void *address = const_cast<uint8_t *>(mappedData);
+
+    if (hint == AccessHint::Sequential)
+    {
+        ::madvise(address, mappedSize, MADV_SEQUENTIAL);
+        ::madvise(address, mappedSize, MADV_WILLNEED);
+    }
+    else
+    {
+        ::madvise(address, mappedSize, MADV_RANDOM);
+    }
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept :
+        mappedData(std::exchange(other.mappedData, nullptr)),
+        mappedSize(std::exchange(other.mappedSize, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+    }
+
+    return *this;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+// Read-only view over a memory-mapped file.
+// The mapping is released when the object is destroyed, so any view taken
+// from it must not outlive the MappedFile.
+class MappedFile
+{
+public:
+    enum class AccessHint
+    {
+        Sequential,
+        Random,
+    };
+
+private:
+    const uint8_t *mappedData = nullptr;
+    size_t mappedSize = 0;
+
+    void release() noexcept;
+
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path, AccessHint hint = AccessHint::Sequential);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    inline const uint8_t *data() const { return mappedData; }
+    inline size_t size() const { return mappedSize; }
+    inline bool empty() const { return mappedSize == 0; }
+    inline BytesView view() const { return BytesView(mappedData, mappedSize); }
+
+    void advise(AccessHint hint) const;
+};
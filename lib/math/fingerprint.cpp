@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <vector>
+
+#include "fingerprint.h"
+#include "io/endian.h"
+#include "io/mapped_file.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    constexpr uint64_t SEED_HIGH = 0x9E3779B97F4A7C15ULL;
+
+    inline uint64_t read64(const uint8_t *data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, 8);
+        return Endian::toLittle(value);
+    }
+
+    inline uint32_t read32(const uint8_t *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, 4);
+        return Endian::toLittle(value);
+    }
+
+    inline uint64_t mixLane(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * PRIME2;
+        accumulator = std::rotl(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    inline uint64_t mergeRound(uint64_t accumulator, uint64_t lane)
+    {
+        accumulator ^= mixLane(0, lane);
+        return accumulator * PRIME1 + PRIME4;
+    }
+
+    inline void consumeStripe(uint64_t *lanes, const uint8_t *data)
+    {
+        lanes[0] = mixLane(lanes[0], read64(data));
+        lanes[1] = mixLane(lanes[1], read64(data + 8));
+        lanes[2] = mixLane(lanes[2], read64(data + 16));
+        lanes[3] = mixLane(lanes[3], read64(data + 24));
+    }
+}
+
+std::string Fingerprint::Hash128::toString() const
+{
+    return fmt::format("{:016x}{:016x}", high, low);
+}
+
+Fingerprint::Hasher::Hasher(uint64_t _seed) : seed(_seed)
+{
+    lanes[0] = seed + PRIME1 + PRIME2;
+    lanes[1] = seed + PRIME2;
+    lanes[2] = seed;
+    lanes[3] = seed - PRIME1;
+}
+
+void Fingerprint::Hasher::update(BytesView data)
+{
+    const uint8_t *input = data.data();
+    size_t size = data.size();
+
+    totalSize += size;
+
+    // complete a stripe left over by the previous update
+    if (stripeSize > 0)
+    {
+        size_t count = std::min(size, sizeof(stripe) - stripeSize);
+        std::memcpy(stripe + stripeSize, input, count);
+
+        stripeSize += count;
+        input += count;
+        size -= count;
+
+        if (stripeSize < sizeof(stripe))
+            return;
+
+        consumeStripe(lanes, stripe);
+        stripeSize = 0;
+    }
+
+    for (; size >= sizeof(stripe); input += sizeof(stripe), size -= sizeof(stripe))
+    {
+        consumeStripe(lanes, input);
+    }
+
+    if (size > 0)
+    {
+        std::memcpy(stripe, input, size);
+        stripeSize = size;
+    }
+}
+
+uint64_t Fingerprint::Hasher::digest() const
+{
+    uint64_t hash;
+
+    if (totalSize >= sizeof(stripe))
+    {
+        hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+        hash = mergeRound(hash, lanes[0]);
+        hash = mergeRound(hash, lanes[1]);
+        hash = mergeRound(hash, lanes[2]);
+        hash = mergeRound(hash, lanes[3]);
+    }
+    else
+    {
+        hash = seed + PRIME5;
+    }
+
+    hash += totalSize;
+
+    const uint8_t *input = stripe;
+    size_t size = stripeSize;
+
+    for (; size >= 8; input += 8, size -= 8)
+    {
+        hash ^= mixLane(0, read64(input));
+        hash = std::rotl(hash, 27) * PRIME1 + PRIME4;
+    }
+
+    if (size >= 4)
+    {
+        hash ^= static_cast<uint64_t>(read32(input)) * PRIME1;
+        hash = std::rotl(hash, 23) * PRIME2 + PRIME3;
+        input += 4;
+        size -= 4;
+    }
+
+    for (; size > 0; input++, size--)
+    {
+        hash ^= *input * PRIME5;
+        hash = std::rotl(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+Fingerprint::Hasher128::Hasher128() : low(0), high(SEED_HIGH) {}
+
+void Fingerprint::Hasher128::update(BytesView data)
+{
+    low.update(data);
+    high.update(data);
+}
+
+Fingerprint::Hash128 Fingerprint::Hasher128::digest() const
+{
+    return Hash128{ low.digest(), high.digest() };
+}
+
+uint64_t Fingerprint::hash64(BytesView data, uint64_t seed)
+{
+    Hasher hasher(seed);
+    hasher.update(data);
+    return hasher.digest();
+}
+
+Fingerprint::Hash128 Fingerprint::hash128(BytesView data)
+{
+    Hasher128 hasher;
+    hasher.update(data);
+    return hasher.digest();
+}
+
+Fingerprint::Hash128 Fingerprint::file(const std::string &path)
+{
+    static constexpr size_t SLICE_SIZE = 1 << 20;
+
+    MappedFile mappedFile(path, MappedFile::AccessHint::Sequential);
+    BytesView view = mappedFile.view();
+
+    // both hashers walk the same slice while it is still in cache
+    Hasher128 hasher;
+    for (size_t offset = 0; offset < view.size(); offset += SLICE_SIZE)
+    {
+        hasher.update(view.subspan(offset, std::min(SLICE_SIZE, view.size() - offset)));
+    }
+
+    return hasher.digest();
+}
+
+Fingerprint::Hash128 Fingerprint::directory(const std::string &path, std::span<const std::string_view> extensions)
+{
+    std::vector<fs::path> files;
+
+    for (auto &entry : fs::directory_iterator(path))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::string extension = entry.path().extension().string();
+        if (!extensions.empty() && std::find(extensions.begin(), extensions.end(), extension) == extensions.end())
+            continue;
+
+        files.push_back(entry.path());
+    }
+
+    std::sort(files.begin(), files.end());
+
+    Hasher128 hasher;
+
+    for (const fs::path &file : files)
+    {
+        std::string name = file.filename().string();
+        Hash128 content = Fingerprint::file(file.string());
+
+        uint64_t record[3] = {
+            Endian::toLittle(static_cast<uint64_t>(fs::file_size(file))),
+            Endian::toLittle(content.low),
+            Endian::toLittle(content.high),
+        };
+
+        hasher.update(BytesView(reinterpret_cast<const uint8_t *>(name.c_str()), name.size() + 1));
+        hasher.update(BytesView(reinterpret_cast<const uint8_t *>(record), sizeof(record)));
+    }
+
+    return hasher.digest();
+}
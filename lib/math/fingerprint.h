@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "types.h"
+
+// Fast non-cryptographic content hashes (XXH64) used as cache keys.
+// Use MD5 only when a digest has to match an external tool.
+namespace Fingerprint
+{
+    struct Hash128
+    {
+        uint64_t low = 0;
+        uint64_t high = 0;
+
+        bool operator==(const Hash128 &other) const = default;
+        std::string toString() const;
+    };
+
+    // Incremental XXH64: feeding a buffer in several parts gives the same
+    // digest as hashing it at once.
+    class Hasher
+    {
+    private:
+        uint64_t seed;
+        uint64_t lanes[4];
+        uint8_t stripe[32];
+        size_t stripeSize = 0;
+        uint64_t totalSize = 0;
+
+    public:
+        explicit Hasher(uint64_t _seed = 0);
+
+        void update(BytesView data);
+        uint64_t digest() const;
+    };
+
+    // Two XXH64 with independent seeds, not compatible with XXH128.
+    class Hasher128
+    {
+    private:
+        Hasher low;
+        Hasher high;
+
+    public:
+        Hasher128();
+
+        void update(BytesView data);
+        Hash128 digest() const;
+    };
+
+    uint64_t hash64(BytesView data, uint64_t seed = 0);
+    Hash128 hash128(BytesView data);
+
+    Hash128 file(const std::string &path);
+
+    // Combines name, size and content of the files directly inside the
+    // directory, in name order. An empty extensions list keeps every file.
+    Hash128 directory(const std::string &path, std::span<const std::string_view> extensions = {});
+}
@@ -34,7 +34,9 @@
 /////////////////////////////////////////////////////////////////////////
 
 #include "md5.h"
+#include "io/endian.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <memory.h>
 #include <stdio.h>
@@ -69,17 +71,181 @@ static unsigned char PADDING[64] =
 
 // md5::toHash
 // Computes a string MD5 hash from a bytes buffer.
-std::string MD5::toHash(const std::vector<uint8_t>& data)
+std::string MD5::toHash(BytesView data)
 {
+    return toHash(std::span<const BytesView>(&data, 1));
+}
+
+// md5::toHash
+// Computes a single string MD5 hash over several buffers, as if they were
+// concatenated, without copying them.
+std::string MD5::toHash(std::span<const BytesView> buffers)
+{
+    // Update takes a 32 bits length
+    static constexpr size_t MAX_UPDATE_SIZE = 1u << 30;
+
     MD5 alg;
 
-    if (!data.empty())
-        alg.Update((unsigned char*)data.data(), (unsigned int)data.size());
+    for (BytesView data : buffers)
+    {
+        for (size_t offset = 0; offset < data.size(); offset += MAX_UPDATE_SIZE)
+        {
+            size_t size = std::min(MAX_UPDATE_SIZE, data.size() - offset);
+            alg.Update((unsigned char*)data.data() + offset, (unsigned int)size);
+        }
+    }
 
     alg.Finalize();
 
-    unsigned char* digest = alg.Digest();
+    return toHex(alg.Digest());
+}
 
+// md5::toHashes
+// Computes one string MD5 hash per buffer. The buffers are processed in
+// groups of LANES messages: every step of the transform is applied to all
+// the lanes at once, which lets the compiler keep them in vector registers.
+std::vector<std::string> MD5::toHashes(std::span<const BytesView> buffers)
+{
+    static constexpr size_t LANES = 4;
+
+    static constexpr uint4 K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    static constexpr uint4 SHIFTS[16] = { S11, S12, S13, S14, S21, S22, S23, S24, S31, S32, S33, S34, S41, S42, S43, S44 };
+    static const uchar ZERO_BLOCK[64] = {};
+
+    std::vector<std::string> hashes(buffers.size());
+
+    for (size_t first = 0; first < buffers.size(); first += LANES)
+    {
+        size_t lanesCount = std::min(LANES, buffers.size() - first);
+
+        // the last one or two blocks of every message hold its tail, the padding and the length
+        uchar tails[LANES][128] = {};
+        size_t fullBlocks[LANES] = {};
+        size_t blocksCount[LANES] = {};
+        size_t maxBlocks = 0;
+
+        for (size_t lane = 0; lane < lanesCount; lane++)
+        {
+            BytesView data = buffers[first + lane];
+            size_t remainder = data.size() % 64;
+            size_t tailSize = remainder < 56 ? 64 : 128;
+
+            fullBlocks[lane] = data.size() / 64;
+            blocksCount[lane] = fullBlocks[lane] + tailSize / 64;
+            maxBlocks = std::max(maxBlocks, blocksCount[lane]);
+
+            if (remainder > 0)
+                memcpy(tails[lane], data.data() + fullBlocks[lane] * 64, remainder);
+
+            tails[lane][remainder] = 0x80;
+
+            uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+            for (size_t i = 0; i < 8; i++)
+            {
+                tails[lane][tailSize - 8 + i] = static_cast<uchar>(bits >> (i * 8));
+            }
+        }
+
+        uint4 state[4][LANES];
+        for (size_t lane = 0; lane < LANES; lane++)
+        {
+            state[0][lane] = 0x67452301;
+            state[1][lane] = 0xefcdab89;
+            state[2][lane] = 0x98badcfe;
+            state[3][lane] = 0x10325476;
+        }
+
+        for (size_t block = 0; block < maxBlocks; block++)
+        {
+            // finished or unused lanes transform a zero block, their state is left untouched
+            uint4 x[16][LANES];
+            for (size_t lane = 0; lane < LANES; lane++)
+            {
+                const uchar *input = ZERO_BLOCK;
+
+                if (lane < lanesCount && block < blocksCount[lane])
+                {
+                    input = block < fullBlocks[lane] ? buffers[first + lane].data() + block * 64 : tails[lane] + (block - fullBlocks[lane]) * 64;
+                }
+
+                for (size_t word = 0; word < 16; word++)
+                {
+                    x[word][lane] = (uint4)input[word * 4] | ((uint4)input[word * 4 + 1] << 8) | ((uint4)input[word * 4 + 2] << 16) | ((uint4)input[word * 4 + 3] << 24);
+                }
+            }
+
+            uint4 a[LANES], b[LANES], c[LANES], d[LANES];
+            memcpy(a, state[0], sizeof(a));
+            memcpy(b, state[1], sizeof(b));
+            memcpy(c, state[2], sizeof(c));
+            memcpy(d, state[3], sizeof(d));
+
+            for (size_t step = 0; step < 64; step++)
+            {
+                size_t round = step / 16;
+                size_t word = round == 0 ? step : round == 1 ? (5 * step + 1) % 16 : round == 2 ? (3 * step + 5) % 16 : (7 * step) % 16;
+                uint4 shift = SHIFTS[round * 4 + step % 4];
+
+                for (size_t lane = 0; lane < LANES; lane++)
+                {
+                    uint4 f = round == 0 ? ((b[lane] & c[lane]) | (~b[lane] & d[lane]))
+                        : round == 1 ? ((b[lane] & d[lane]) | (c[lane] & ~d[lane]))
+                        : round == 2 ? (b[lane] ^ c[lane] ^ d[lane])
+                        : (c[lane] ^ (b[lane] | ~d[lane]));
+
+                    uint4 sum = a[lane] + f + x[word][lane] + K[step];
+
+                    a[lane] = d[lane];
+                    d[lane] = c[lane];
+                    c[lane] = b[lane];
+                    b[lane] = b[lane] + ((sum << shift) | (sum >> (32 - shift)));
+                }
+            }
+
+            for (size_t lane = 0; lane < lanesCount; lane++)
+            {
+                if (block >= blocksCount[lane])
+                    continue;
+
+                state[0][lane] += a[lane];
+                state[1][lane] += b[lane];
+                state[2][lane] += c[lane];
+                state[3][lane] += d[lane];
+            }
+        }
+
+        for (size_t lane = 0; lane < lanesCount; lane++)
+        {
+            uchar digest[16];
+            for (size_t word = 0; word < 4; word++)
+            {
+                for (size_t i = 0; i < 4; i++)
+                {
+                    digest[word * 4 + i] = static_cast<uchar>(state[word][lane] >> (i * 8));
+                }
+            }
+
+            hashes[first + lane] = toHex(digest);
+        }
+    }
+
+    return hashes;
+}
+
+// md5::toHex
+// Formats a 16 bytes digest as 32 lowercase hex characters.
+std::string MD5::toHex(const uchar *digest)
+{
     char hexOutput[33]; // 32 chars + null terminator
     sprintf_s(hexOutput,
             "%02x%02x%02x%02x%02x%02x%02x%02x"
@@ -283,6 +449,13 @@ void MD5::Decode(uint4* dest, uchar* src, uint4 nLength)
 
 	assert(nLength % 4 == 0);
 
+	// the block is already in host order on little-endian machines
+	if constexpr (Endian::isNativeLittle)
+	{
+		memcpy(dest, src, nLength);
+		return;
+	}
+
 	for (i = 0, j = 0; j < nLength; i++, j += 4)
 	{
 		dest[i] = ((uint4)src[j]) | (((uint4)src[j+1])<<8) |
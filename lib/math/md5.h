@@ -35,9 +35,12 @@
 #pragma once
 
 #include <string>
+#include <span>
 #include <vector>
 #include <cstdint>
 
+#include "types.h"
+
 typedef unsigned int uint4;
 typedef unsigned short int uint2;
 typedef unsigned char uchar;
@@ -46,7 +49,11 @@ class MD5
 {
     // Methods
 public:
-    static std::string toHash(const std::vector<uint8_t> &data);
+    static std::string toHash(BytesView data);
+    // single digest of the buffers, as if they were concatenated
+    static std::string toHash(std::span<const BytesView> buffers);
+    // one digest per buffer, several buffers are transformed side by side
+    static std::vector<std::string> toHashes(std::span<const BytesView> buffers);
 
 private:
     MD5() { Init(); }
@@ -55,6 +62,8 @@ private:
     void Finalize();
     uchar *Digest() { return m_Digest; }
 
+    static std::string toHex(const uchar *digest);
+
     void Transform(uchar *block);
     void Encode(uchar *dest, uint4 *src, uint4 nLength);
     void Decode(uint4 *dest, uchar *src, uint4 nLength);
@@ -1,13 +1,23 @@
+#include <chrono>
 #include <fmt/format.h>
-#include <filesystem>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "constants.h"
+#include "core/cell.h"
+#include "files/cell_cache.h"
 #include "files/lotheader.h"
 #include "files/lotpack.h"
+#include "files/map_archive.h"
+#include "files/map_manifest.h"
+#include "io/batch_loader.h"
 #include "map_files_service.h"
-
-namespace fs = std::filesystem;
+#include "math/vector2i.h"
+#include "threading/parallel.h"
+#include "types.h"
 
 MapFilesService::MapFilesService(std::string _gamePath, std::string _mapName)
 {
@@ -19,74 +29,277 @@ void MapFilesService::LoadMapFiles()
 {
     fmt::println("Loading map '{}'", mapName);
 
-    std::string mapDirectory = gamePath + "/media/maps/" + mapName;
+    std::string mapDirectory = this->mapDirectory();
 
     auto start = std::chrono::high_resolution_clock::now();
     auto filescount = 0;
 
-    for (auto &entry : fs::directory_iterator(mapDirectory))
+    if (archive)
     {
-        fs::path path = entry.path();
+        BytesBuffer headerScratch;
+        BytesBuffer lotpackScratch;
 
-        if (path.extension().string() != constants::LOTHEADER_EXT)
-            continue;
+        for (const MapArchive::Entry &entry : archive->getEntries())
+        {
+            if (entry.type != MapArchive::EntryType::LotHeader)
+                continue;
 
-        std::string lotheaderPath = path.string();
-        std::string lotpackPath = path.replace_filename("world_" + path.filename().replace_extension(constants::LOTPACK_EXT).string()).string();
+            const MapArchive::Entry *lotpackEntry = archive->find(entry.position, MapArchive::EntryType::Lotpack);
+            if (lotpackEntry == nullptr)
+                continue;
 
-        fmt::println("lotheader: '{} ({})'", lotheaderPath, fs::exists(lotheaderPath));
-        // fmt::println("lotpack  : '{} ({})'\n", lotpackPath, fs::exists(lotpackPath));
+            std::unique_ptr<Cell> cell = Cell::read(archive->read(entry, headerScratch), archive->read(*lotpackEntry, lotpackScratch), entry.position);
 
-        LotHeader lotheader = LotHeader::read(lotheaderPath);
-        Lotpack lotpack = Lotpack::read(lotpackPath, &lotheader);
+            int hash = entry.position.x + entry.position.y * constants::MAX_CELLS_SIZE;
+            cells[hash] = std::move(cell);
 
-        int hash = lotheader.position.x + lotheader.position.y * constants::MAX_CELLS_SIZE;
-        lotheaders[hash] = lotheader;
-        lotpacks[hash] = lotpack;
+            filescount++;
+        }
 
-        filescount++;
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+        fmt::println("{} files parsed from archive in {} ms", filescount, duration);
+        return;
+    }
+
+    MapManifest manifest = MapManifest::load(mapDirectory);
+
+    if (cellCacheDirectory)
+    {
+        std::vector<std::unique_ptr<Cell>> loaded(manifest.cells.size());
+
+        Parallel::forEach(manifest.cells.size(), [&](size_t i)
+        {
+            const MapManifest::Cell &manifestCell = manifest.cells[i];
+            loaded[i] = loadCachedCell(manifest, manifestCell, LotHeader::SECTION_ALL, false);
+
+            if (!loaded[i])
+            {
+                loaded[i] = std::make_unique<Cell>(LotHeader::read(manifest.lotheaderPath(manifestCell)));
+                loaded[i]->lotpack = Lotpack::read(manifest.lotpackPath(manifestCell), &loaded[i]->header);
+            }
+        });
+
+        for (std::unique_ptr<Cell> &cell : loaded)
+        {
+            int hash = cell->header.position.x + cell->header.position.y * constants::MAX_CELLS_SIZE;
+            cells[hash] = std::move(cell);
+            filescount++;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+        fmt::println("{} cells loaded from cell cache '{}' in {} ms", filescount, *cellCacheDirectory, duration);
+        return;
     }
 
+    // each cell is read as a (lotheader, lotpack) pair: even indices are headers
+
+    std::vector<std::string> paths;
+    std::vector<Vector2i> positions;
+    paths.reserve(manifest.cells.size() * 2);
+    positions.reserve(manifest.cells.size());
+
+    for (const MapManifest::Cell &cell : manifest.cells)
+    {
+        positions.push_back(cell.position);
+        paths.push_back(manifest.lotheaderPath(cell));
+        paths.push_back(manifest.lotpackPath(cell));
+    }
+
+    fmt::println("{} cells listed in manifest '{}'", manifest.cells.size(), MapManifest::manifestPath(mapDirectory));
+
+    std::vector<BytesBuffer> buffers(paths.size());
+    std::vector<uint8_t> loadedCount(positions.size(), 0);
+
+    BatchLoader loader;
+    loader.load(paths, [&](size_t index, BytesBuffer &&buffer)
+    {
+        size_t cell = index / 2;
+        buffers[index] = std::move(buffer);
+
+        // parse as soon as both files of the cell are available
+        if (++loadedCount[cell] < 2)
+            return;
+
+        BytesBuffer headerBuffer = std::move(buffers[cell * 2]);
+        BytesBuffer lotpackBuffer = std::move(buffers[cell * 2 + 1]);
+
+        int hash = positions[cell].x + positions[cell].y * constants::MAX_CELLS_SIZE;
+        cells[hash] = Cell::read(headerBuffer, lotpackBuffer, positions[cell]);
+
+        filescount++;
+    });
+
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
     fmt::println("{} files parsed in {} ms", filescount, duration);
 }
 
-LotHeader *MapFilesService::getLotheaderByPosition(int x, int y)
+Cell *MapFilesService::getCellByPosition(int x, int y)
 {
-    int hash = x + y * constants::MAX_CELLS_SIZE;
+    auto it = cells.find(x + y * constants::MAX_CELLS_SIZE);
 
-    if (lotheaders.contains(hash))
+    if (it != cells.end())
     {
-        return &lotheaders[hash];
+        return it->second.get();
     }
 
     return nullptr;
 }
 
+LotHeader *MapFilesService::getLotheaderByPosition(int x, int y)
+{
+    Cell *cell = getCellByPosition(x, y);
+
+    return cell != nullptr ? &cell->header : nullptr;
+}
+
 Lotpack *MapFilesService::getLotpackByPosition(int x, int y)
 {
-    int hash = x + y * constants::MAX_CELLS_SIZE;
+    Cell *cell = getCellByPosition(x, y);
+
+    return cell != nullptr ? &cell->lotpack : nullptr;
+}
+
+void MapFilesService::OpenArchive(const std::string &archivePath)
+{
+    archive = MapArchive::open(archivePath);
+}
+
+bool MapFilesService::UseCellCache(const std::string &cacheDirectory)
+{
+    std::string directory = cacheDirectory.empty() ? CellCache::defaultDirectory(mapDirectory()) : cacheDirectory;
 
-    if (lotpacks.contains(hash))
+    // checked once: with a directory that can't be written, every cell would
+    // be decoded for the cache, fail to save, then be decoded again
+    if (!CellCache::isWritableDirectory(directory))
     {
-        return &lotpacks[hash];
+        fmt::println("Cell cache directory '{}' is not writable, cells are decoded from the map files", directory);
+        cellCacheDirectory.reset();
+        return false;
+    }
+
+    cellCacheDirectory = directory;
+    return true;
+}
+
+std::string MapFilesService::mapDirectory() const
+{
+    return gamePath + "/media/maps/" + mapName;
+}
+
+std::unique_ptr<Cell> MapFilesService::loadCachedCellByPosition(int x, int y, uint32_t sections, bool lazy)
+{
+    if (!cellCacheDirectory || archive)
+        return nullptr;
+
+    if (!manifest)
+    {
+        manifest = MapManifest::load(mapDirectory());
+    }
+
+    for (const MapManifest::Cell &cell : manifest->cells)
+    {
+        if (cell.position.x == x && cell.position.y == y)
+            return loadCachedCell(*manifest, cell, sections, lazy);
     }
 
     return nullptr;
 }
 
-LotHeader MapFilesService::LoadLotheaderByPosition(int x, int y)
+std::unique_ptr<Cell> MapFilesService::loadCachedCell(const MapManifest &cellManifest, const MapManifest::Cell &manifestCell, uint32_t sections, bool lazy) const
+{
+    // the cache only replaces the lotpack decoding, an unusable cache must not prevent loading the map
+    try
+    {
+        auto cache = std::make_shared<const CellCache>(CellCache::load(cellManifest, manifestCell, *cellCacheDirectory));
+
+        // the cache names are already interned, only the other sections are decoded
+        auto cell = std::make_unique<Cell>(LotHeader::read(cellManifest.lotheaderPath(manifestCell), sections & ~LotHeader::SECTION_TILE_NAMES));
+        cell->header.tileIds = cache->tileIds;
+        cell->header.loadedSections |= LotHeader::SECTION_TILE_NAMES;
+        cell->lotpack = CellCache::mapLotpack(std::move(cache), &cell->header, lazy);
+
+        return cell;
+    }
+    catch (const std::exception &)
+    {
+        return nullptr;
+    }
+}
+
+const MapArchive::Entry &MapFilesService::findArchiveEntry(int x, int y, MapArchive::EntryType type) const
+{
+    const MapArchive::Entry *entry = archive->find(Vector2i(x, y), type);
+    if (entry == nullptr)
+    {
+        throw std::runtime_error(fmt::format("Cell {}_{} not found in map archive", x, y));
+    }
+
+    return *entry;
+}
+
+LotHeader MapFilesService::LoadLotheaderByPosition(int x, int y, uint32_t sections)
 {
+    if (archive)
+    {
+        BytesBuffer scratch;
+        return LotHeader::read(archive->read(findArchiveEntry(x, y, MapArchive::EntryType::LotHeader), scratch), Vector2i(x, y), sections);
+    }
+
     std::string path = fmt::format("{}/media/maps/{}/{}_{}.lotheader", gamePath, mapName, x, y);
 
-    return LotHeader::read(path);
+    return LotHeader::read(path, sections);
+}
+
+std::unique_ptr<Cell> MapFilesService::LoadCellByPosition(int x, int y, uint32_t sections)
+{
+    if (std::unique_ptr<Cell> cell = loadCachedCellByPosition(x, y, sections, false))
+        return cell;
+
+    auto cell = std::make_unique<Cell>(LoadLotheaderByPosition(x, y, sections));
+
+    if (archive)
+    {
+        BytesBuffer scratch;
+        cell->lotpack = Lotpack::readParallel(archive->read(findArchiveEntry(x, y, MapArchive::EntryType::Lotpack), scratch), &cell->header);
+
+        return cell;
+    }
+
+    std::string path = fmt::format("{}/media/maps/{}/world_{}_{}.lotpack", gamePath, mapName, x, y);
+    cell->lotpack = Lotpack::readParallel(path, &cell->header);
+
+    return cell;
 }
 
-Lotpack MapFilesService::LoadLotpackByPosition(int x, int y, LotHeader *header)
+std::unique_ptr<Cell> MapFilesService::OpenCellByPosition(int x, int y, uint32_t sections)
 {
+    if (std::unique_ptr<Cell> cell = loadCachedCellByPosition(x, y, sections, true))
+        return cell;
+
+    auto cell = std::make_unique<Cell>(LoadLotheaderByPosition(x, y, sections));
+
+    if (archive)
+    {
+        BytesBuffer scratch;
+        BytesView data = archive->read(findArchiveEntry(x, y, MapArchive::EntryType::Lotpack), scratch);
+
+        // inflated entries already live in the scratch buffer, raw ones point into the archive
+        if (data.data() == scratch.data())
+            cell->lotpack = Lotpack::open(std::move(scratch), &cell->header);
+        else
+            cell->lotpack = Lotpack::open(BytesBuffer(data.begin(), data.end()), &cell->header);
+
+        return cell;
+    }
+
     std::string path = fmt::format("{}/media/maps/{}/world_{}_{}.lotpack", gamePath, mapName, x, y);
+    cell->lotpack = Lotpack::open(path, &cell->header);
 
-    return Lotpack::read(path, header);
-}
\ No newline at end of file
+    return cell;
+}
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
+#include "core/cell.h"
 #include "files/lotheader.h"
 #include "files/lotpack.h"
+#include "files/map_archive.h"
+#include "files/map_manifest.h"
 
 class MapFilesService
 {
@@ -12,17 +18,44 @@ private:
     std::string gamePath;
     std::string mapName;
 
-    std::unordered_map<uint32_t, Lotpack> lotpacks;
-    std::unordered_map<uint32_t, LotHeader> lotheaders;
+    // cells never move once loaded, pointers returned by the getters stay valid
+    std::unordered_map<uint32_t, std::unique_ptr<Cell>> cells;
+
+    std::optional<MapArchive> archive;
+
+    std::optional<std::string> cellCacheDirectory;
+    std::optional<MapManifest> manifest;
+
+    std::string mapDirectory() const;
+    const MapArchive::Entry &findArchiveEntry(int x, int y, MapArchive::EntryType type) const;
+
+    // the lotpack views the mapped cache and the header takes its tile names
+    // from it; nullptr when the cache can't be read nor saved, the cell is
+    // then decoded
+    std::unique_ptr<Cell> loadCachedCell(const MapManifest &cellManifest, const MapManifest::Cell &manifestCell, uint32_t sections, bool lazy) const;
+    std::unique_ptr<Cell> loadCachedCellByPosition(int x, int y, uint32_t sections, bool lazy);
 
 public:
     MapFilesService(std::string _gamePath, std::string _mapName);
 
+    // once opened, cells are read from the archive instead of the map directory
+    void OpenArchive(const std::string &archivePath);
     void LoadMapFiles();
 
+    // lotpacks of the map directory are mapped from CellCache files, created
+    // on first use; defaults to CellCache::defaultDirectory. Returns false and
+    // keeps decoding the map files when the directory isn't writable.
+    bool UseCellCache(const std::string &cacheDirectory = "");
+
+    Cell *getCellByPosition(int x, int y);
     LotHeader *getLotheaderByPosition(int x, int y);
     Lotpack *getLotpackByPosition(int x, int y);
 
-    LotHeader LoadLotheaderByPosition(int x, int y);
-    Lotpack LoadLotpackByPosition(int x, int y, LotHeader *header);
+    // sections are the lotheader sections to decode, see LotHeader::read
+    LotHeader LoadLotheaderByPosition(int x, int y, uint32_t sections = LotHeader::SECTION_ALL);
+    std::unique_ptr<Cell> LoadCellByPosition(int x, int y, uint32_t sections = LotHeader::SECTION_ALL);
+
+    // blocks are decoded on demand, see Lotpack::open; cached cells are mapped
+    // and their blocks only visited once loaded
+    std::unique_ptr<Cell> OpenCellByPosition(int x, int y, uint32_t sections = LotHeader::SECTION_ALL);
 };
\ No newline at end of file
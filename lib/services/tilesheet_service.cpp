@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "constants.h"
+#include "core/tile_name_registry.h"
 #include "files/texturepack.h"
 #include "files/tiledefinition.h"
 #include "tilesheet_service.h"
@@ -79,6 +80,49 @@ TexturePack::Page *TilesheetService::getPageByTextureName(const std::string &tex
     return nullptr;
 }
 
+TexturePack::Texture *TilesheetService::getTextureByTileId(uint32_t tileId)
+{
+    if (!resolveTileIds(tileId))
+        return nullptr;
+
+    return texturesByTileId[tileId];
+}
+
+TexturePack::Page *TilesheetService::getPageByTileId(uint32_t tileId)
+{
+    if (!resolveTileIds(tileId))
+        return nullptr;
+
+    return pagesByTileId[tileId];
+}
+
+bool TilesheetService::resolveTileIds(uint32_t tileId)
+{
+    if (tileId < texturesByTileId.size())
+        return true;
+
+    TileNameRegistry &registry = TileNameRegistry::global();
+    size_t registrySize = registry.size();
+
+    if (tileId >= registrySize)
+        return false;
+
+    size_t first = texturesByTileId.size();
+
+    texturesByTileId.resize(registrySize, nullptr);
+    pagesByTileId.resize(registrySize, nullptr);
+
+    for (size_t id = first; id < registrySize; id++)
+    {
+        std::string name(registry.name(static_cast<uint32_t>(id)));
+
+        texturesByTileId[id] = getTextureByName(name);
+        pagesByTileId[id] = getPageByTextureName(name);
+    }
+
+    return true;
+}
+
 void TilesheetService::readTileDefinitions()
 {
     std::string tilesDefDirectory = gamePath + "/media";
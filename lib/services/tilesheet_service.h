@@ -2,6 +2,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "files/texturepack.h"
 #include "files/tiledefinition.h"
@@ -21,14 +22,21 @@ public:
     std::unordered_map<std::string, TileDefinition::TileData *> tilesDefByName;
     std::unordered_map<std::string, std::string> textureToPageName;
 
+    // indexed by TileNameRegistry id, extended as new names get interned
+    std::vector<TexturePack::Texture *> texturesByTileId;
+    std::vector<TexturePack::Page *> pagesByTileId;
+
     TilesheetService(std::string _gamePath, LoadingPayload &loadingPayload);
 
     TexturePack::Texture *getTextureByName(const std::string &textureName, TexturePack::Page *page);
     TexturePack::Texture *getTextureByName(const std::string &textureName);
     TexturePack::Page *getPageByTextureName(const std::string &textureName);
     TexturePack::Page *getPageByName(const std::string &name);
+    TexturePack::Texture *getTextureByTileId(uint32_t tileId);
+    TexturePack::Page *getPageByTileId(uint32_t tileId);
 
 private:
     void readTileDefinitions();
     void readTexturePacks();
+    bool resolveTileIds(uint32_t tileId);
 };
\ No newline at end of file
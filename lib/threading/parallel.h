@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+    inline size_t defaultThreads()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Runs body(i) for every i in [0, count) on up to `threads` threads
+    // (0 = hardware concurrency). Indices are handed out one at a time, so
+    // uneven items balance out. The first exception thrown by body stops the
+    // remaining items and is rethrown on the calling thread.
+    template <typename Body>
+    void forEach(size_t count, Body &&body, size_t threads = 0)
+    {
+        size_t threadsCount = std::min(threads > 0 ? threads : defaultThreads(), count);
+
+        if (threadsCount <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                body(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto worker = [&]()
+        {
+            for (size_t i = next++; i < count && !failed; i = next++)
+            {
+                try
+                {
+                    body(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(errorMutex);
+
+                    if (!error)
+                        error = std::current_exception();
+
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threadsCount - 1);
+
+        // the started workers use the locals above, they must be joined before a failed start unwinds
+        try
+        {
+            for (size_t i = 1; i < threadsCount; i++)
+            {
+                workers.emplace_back(worker);
+            }
+        }
+        catch (...)
+        {
+            failed = true;
+
+            for (std::thread &thread : workers)
+            {
+                thread.join();
+            }
+
+            throw;
+        }
+
+        // the calling thread takes its share too
+        worker();
+
+        for (std::thread &thread : workers)
+        {
+            thread.join();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
 using byte = uint8_t;
 using BytesBuffer = std::vector<uint8_t>;
+using BytesView = std::span<const uint8_t>;
 using StringArray = std::vector<std::string>;
\ No newline at end of file
@@ -6,7 +6,7 @@
 #include "constants.h"
 #include "core/atlas_graph.h"
 #include "files/lotheader.h"
-#include "math/math.h"
+#include "io/batch_loader.h"
 #include "platform.h"
 #include "timer.h"
 
@@ -31,6 +31,8 @@ public:
 
         AtlasGraph atlasGraph;
 
+        std::vector<std::string> paths;
+
         for (auto &entry : std::filesystem::directory_iterator(mapDirectory))
         {
             std::filesystem::path path = entry.path();
@@ -38,17 +40,19 @@ public:
             if (path.extension().string() != constants::LOTHEADER_EXT)
                 continue;
 
-            LotHeader header = LotHeader::read(path.string());
+            paths.push_back(path.string());
+        }
 
-            AtlasGraph::Node atlasData;
+        BatchLoader loader;
+        loader.load(paths, [&](size_t index, BytesBuffer &&buffer)
+        {
+            LotHeader header = LotHeader::read(buffer, LotHeader::getPositionFromFilename(paths[index]), LotHeader::SECTION_TILE_NAMES);
 
-            for (const auto &tilename : header.tileNames)
-            {
-                atlasData.hashes.emplace_back(Math::hashFnv1a(tilename));
-            }
+            // registry ids are unique per sprite name, no hashing needed
+            AtlasGraph::Node atlasData(header.tileIds);
 
             atlasGraph.addNode(header.position.hashcode(), std::move(atlasData));
-        }
+        });
 
         atlasGraph.buildGraph();
 
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "command_manager.h"
+#include <filesystem>
+#include <fmt/base.h>
+
+#include "constants.h"
+#include "files/map_archive.h"
+#include "timer.h"
+
+class CmdMapArchive : public BaseCommand
+{
+private:
+    std::string mapName = MapNames::Muldraugh;
+    std::string outputPath;
+    bool noCompression = false;
+
+public:
+    CLI::App *registerCommand(CLI::App &app) override
+    {
+        auto *command = app.add_subcommand("map-archive", "Pack the lotheaders and lotpacks of a map into a single archive.");
+
+        command->add_option("-m,--map", mapName, "Map folder name in media/maps.");
+        command->add_option("-o,--output", outputPath, "Archive path, defaults to '<map><ext>' in the working directory.");
+        command->add_flag("--no-compression", noCompression, "Store entries without deflate.");
+
+        return command;
+    }
+
+    void executeCommand() override
+    {
+        auto mapDirectory = constants::GAME_PATH_B42 + "/media/maps/" + mapName;
+        auto archivePath = outputPath.empty() ? std::filesystem::path(mapName).filename().string() + std::string(MapArchive::EXTENSION) : outputPath;
+        auto timer = Timer::start();
+
+        size_t entriesCount = MapArchive::build(mapDirectory, archivePath, !noCompression);
+
+        fmt::println("{} files packed into '{}' in {}ms, size: {}MB", entriesCount, archivePath, timer.elapsedMiliseconds(), std::filesystem::file_size(archivePath) / 1024 / 1024);
+    }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "command_manager.h"
+#include <fmt/base.h>
+#include <string>
+
+#include "core/map_diff.h"
+#include "timer.h"
+
+class CmdMapDiff : public BaseCommand
+{
+private:
+    std::string beforeDirectory;
+    std::string afterDirectory;
+
+public:
+    CLI::App *registerCommand(CLI::App &app) override
+    {
+        auto *command = app.add_subcommand("map-diff", "Compare two map directories and list the chunks whose squares differ.");
+
+        command->add_option("before", beforeDirectory, "Original map directory.")->required();
+        command->add_option("after", afterDirectory, "Modified map directory.")->required();
+
+        return command;
+    }
+
+    void executeCommand() override
+    {
+        auto timer = Timer::start();
+
+        MapDiff diff = MapDiff::compare(beforeDirectory, afterDirectory);
+
+        for (const MapDiff::CellChange &cell : diff.cells)
+        {
+            switch (cell.status)
+            {
+            case MapDiff::CellStatus::Added:
+                fmt::println("+ {}_{}", cell.position.x, cell.position.y);
+                break;
+            case MapDiff::CellStatus::Removed:
+                fmt::println("- {}_{}", cell.position.x, cell.position.y);
+                break;
+            case MapDiff::CellStatus::FormatChanged:
+                fmt::println("~ {}_{} (B41/B42 format changed)", cell.position.x, cell.position.y);
+                break;
+            case MapDiff::CellStatus::Changed:
+                fmt::println("~ {}_{}{}", cell.position.x, cell.position.y, cell.headerChanged ? " (lotheader changed)" : "");
+
+                for (const MapDiff::ChunkChange &chunk : cell.chunks)
+                {
+                    fmt::println("    chunk {}, {}: {} squares changed ({} -> {})", chunk.chunkX, chunk.chunkY, chunk.squaresChanged, chunk.squaresBefore, chunk.squaresAfter);
+                }
+                break;
+            }
+        }
+
+        fmt::println("{} cells changed, {} chunks changed, {} cells identical in {}ms", diff.cells.size(), diff.changedChunksCount(), diff.identicalCells, timer.elapsedMiliseconds());
+    }
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "command_manager.h"
+#include <fmt/base.h>
+
+#include "constants.h"
+#include "core/spawn_map.h"
+#include "timer.h"
+
+class CmdSpawnMap : public BaseCommand
+{
+private:
+    std::string mapName = MapNames::Muldraugh;
+    std::string outputPath = "Map_ZombieSpawnMap.png";
+
+public:
+    CLI::App *registerCommand(CLI::App &app) override
+    {
+        auto *command = app.add_subcommand("spawn-map", "Export the zombie spawn density of a map as a png, one pixel per chunk.");
+
+        command->add_option("-m,--map", mapName, "Map folder name in media/maps.");
+        command->add_option("-o,--output", outputPath, "Output png path.");
+
+        return command;
+    }
+
+    void executeCommand() override
+    {
+        auto mapDirectory = constants::GAME_PATH_B42 + "/media/maps/" + mapName;
+        auto timer = Timer::start();
+
+        SpawnMap spawnMap = SpawnMap::build(mapDirectory);
+        spawnMap.savePNG(outputPath);
+
+        fmt::println("{}x{} chunks spawn map saved to '{}' in {}ms", spawnMap.widthInChunks, spawnMap.heightInChunks, outputPath, timer.elapsedMiliseconds());
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "command_manager.h"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/base.h>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "core/sprite_index.h"
+#include "core/tile_name_registry.h"
+#include "files/map_manifest.h"
+#include "timer.h"
+
+class CmdSpriteIndex : public BaseCommand
+{
+private:
+    std::string mapName = MapNames::Muldraugh;
+    std::string indexPath;
+    std::string cellCacheDirectory;
+    std::vector<std::string> sprites;
+    bool rebuild = false;
+
+public:
+    CLI::App *registerCommand(CLI::App &app) override
+    {
+        auto *command = app.add_subcommand("sprite-index", "Index where every sprite of a map is used and query the squares using a set of sprites.");
+
+        command->add_option("-m,--map", mapName, "Map folder name in media/maps.");
+        command->add_option("-o,--output", indexPath, "Index path, defaults to '<map><ext>' in the working directory.");
+        command->add_option("-q,--query", sprites, "Sprite names, lists the squares using all of them.");
+        command->add_option("--cell-cache", cellCacheDirectory, "Directory of decoded cell caches, created and reused across runs.");
+        command->add_flag("--rebuild", rebuild, "Rebuild the index even if the file exists.");
+
+        return command;
+    }
+
+    void executeCommand() override
+    {
+        auto mapDirectory = constants::GAME_PATH_B42 + "/media/maps/" + mapName;
+        auto path = indexPath.empty() ? std::filesystem::path(mapName).filename().string() + std::string(SpriteIndex::EXTENSION) : indexPath;
+        auto timer = Timer::start();
+
+        SpriteIndex index;
+
+        if (!rebuild && std::filesystem::exists(path))
+        {
+            index = SpriteIndex::load(path);
+            fmt::println("{} sprites loaded from '{}' in {}ms", index.spritesCount(), path, timer.elapsedMiliseconds());
+        }
+        else
+        {
+            index = SpriteIndex::build(MapManifest::load(mapDirectory), 0, cellCacheDirectory);
+            index.save(path);
+            fmt::println("{} sprites indexed into '{}' in {}ms", index.spritesCount(), path, timer.elapsedMiliseconds());
+        }
+
+        if (sprites.empty())
+            return;
+
+        std::vector<uint32_t> spriteIds;
+        for (const std::string &sprite : sprites)
+        {
+            spriteIds.push_back(TileNameRegistry::global().find(sprite));
+        }
+
+        std::vector<uint64_t> squares;
+        index.intersect(spriteIds, squares);
+
+        fmt::println("{} squares use every queried sprite", squares.size());
+
+        for (size_t i = 0; i < std::min<size_t>(squares.size(), 20); i++)
+        {
+            SpriteIndex::Position position = SpriteIndex::unpackPosition(squares[i]);
+            fmt::println("  {}, {}, {}", position.x, position.y, position.z);
+        }
+    }
+};
@@ -4,6 +4,9 @@
 #include <SFML/Graphics/Vertex.hpp>
 #include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/Graphics/VertexBuffer.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <cstdint>
 #include <stdexcept>
 #include <string>
@@ -23,9 +26,10 @@
 CellViewer::CellViewer(int x, int y, TilesheetService *tilesheetService)
 {
     MapFilesService mapFileService(constants::GAME_PATH, MapNames::Muldraugh);
+    mapFileService.UseCellCache();
 
-    lotheader = mapFileService.LoadLotheaderByPosition(x, y);
-    lotpack = mapFileService.LoadLotpackByPosition(x, y, &lotheader);
+    // only the tile names are drawn, cached cells stay lazy like lotpack files
+    cell = mapFileService.OpenCellByPosition(x, y, LotHeader::SECTION_TILE_NAMES);
 
     packCellSprites(tilesheetService);
     preComputeSprites();
@@ -34,7 +38,7 @@ CellViewer::CellViewer(int x, int y, TilesheetService *tilesheetService)
 void CellViewer::packCellSprites(TilesheetService *tilesheetService)
 {
     auto timer = Timer::start();
-    auto tilesCount = lotheader.tileNames.size();
+    auto tilesCount = cell->header.tileIds.size();
 
     std::unordered_map<TexturePack::Page *, std::vector<size_t>> groupedSprites = {};
     std::vector<sf::Image> sprites(tilesCount);
@@ -44,19 +48,19 @@ void CellViewer::packCellSprites(TilesheetService *tilesheetService)
 
     for (size_t i = 0; i < tilesCount; i++)
     {
-        const std::string &tilename = lotheader.tileNames[i];
-        TexturePack::Texture *textureData = tilesheetService->getTextureByName(tilename);
+        uint32_t tileId = cell->header.tileIds[i];
+        TexturePack::Texture *textureData = tilesheetService->getTextureByTileId(tileId);
 
         if (textureData == nullptr)
         {
-            fmt::println("texture not found: '{}'", tilename);
+            fmt::println("texture not found: '{}'", cell->header.tileName(i));
             continue;
         }
 
-        auto page = tilesheetService->getPageByTextureName(tilename);
+        auto page = tilesheetService->getPageByTileId(tileId);
         if (page == nullptr)
         {
-            throw std::runtime_error("page not found: " + page->name);
+            throw std::runtime_error("page not found: " + std::string(cell->header.tileName(i)));
         }
 
         if (!groupedSprites.contains(page))
@@ -84,8 +88,7 @@ void CellViewer::packCellSprites(TilesheetService *tilesheetService)
 
         for (const auto &index : entry.second)
         {
-            std::string tilename = lotheader.tileNames[index];
-            TexturePack::Texture *textureData = tilesheetService->getTextureByName(tilename);
+            TexturePack::Texture *textureData = spriteDatas[index];
 
             if (textureData == nullptr)
                 continue;
@@ -112,79 +115,84 @@ void CellViewer::preComputeSprites()
 {
     std::unordered_map<uint8_t, std::vector<sf::Vertex>> vertexArrays;
 
-    for (int layer = lotheader.minLayer; layer < lotheader.maxLayer; layer++)
+    for (int layer = cell->header.minLayer; layer < cell->header.maxLayer; layer++)
     {
         vertexArrays[layer] = {};
     }
 
-    for (auto &square : lotpack.squareMap)
+    cell->lotpack.forEachLoadedTable([&](const Lotpack::SquareView &squares)
     {
-        int chunkX = square.coord.chunk_idx() / constants::CELL_SIZE_IN_BLOCKS;
-        int chunkY = square.coord.chunk_idx() % constants::CELL_SIZE_IN_BLOCKS;
-
-        int gx = square.coord.x() + chunkX * constants::BLOCK_SIZE_IN_SQUARE + lotheader.position.x * constants::CELL_SIZE_IN_SQUARE;
-        int gy = square.coord.y() + chunkY * constants::BLOCK_SIZE_IN_SQUARE + lotheader.position.y * constants::CELL_SIZE_IN_SQUARE;
-        int gz = square.coord.z();
+        for (size_t squareIndex = 0; squareIndex < squares.size(); squareIndex++)
+        {
+            CellCoord coord = squares.coords[squareIndex];
 
-        float screenX = (gx - gy) * (constants::TILE_WIDTH / 2);
-        float screenY = (gx + gy) * (constants::TILE_HEIGHT / 2) - gz * (constants::TILE_HEIGHT * 3);
+            int chunkX = coord.chunk_idx() / constants::CELL_SIZE_IN_BLOCKS;
+            int chunkY = coord.chunk_idx() % constants::CELL_SIZE_IN_BLOCKS;
 
-        for (int32_t &spriteId : square.tiles)
-        {
-            TexturePack::Texture *textureData = spriteDatas[spriteId];
+            int gx = coord.x() + chunkX * constants::BLOCK_SIZE_IN_SQUARE + cell->header.position.x * constants::CELL_SIZE_IN_SQUARE;
+            int gy = coord.y() + chunkY * constants::BLOCK_SIZE_IN_SQUARE + cell->header.position.y * constants::CELL_SIZE_IN_SQUARE;
+            int gz = coord.z();
 
-            if (textureData == nullptr)
-                continue;
+            float screenX = (gx - gy) * (constants::TILE_WIDTH / 2);
+            float screenY = (gx + gy) * (constants::TILE_HEIGHT / 2) - gz * (constants::TILE_HEIGHT * 3);
 
-            sf::Sprite sprite(atlasTexture);
-            rectpack2D::rect_xywh &rectangle = rectangles[spriteId];
-
-            float x = screenX + textureData->ox;
-            float y = screenY + textureData->oy;
-            float w = static_cast<float>(rectangle.w);
-            float h = static_cast<float>(rectangle.h);
-
-            float tx = static_cast<float>(rectangle.x);
-            float ty = static_cast<float>(rectangle.y);
-            float tw = static_cast<float>(rectangle.w);
-            float th = static_cast<float>(rectangle.h);
-
-            sf::Vertex v0 = {
-                .position = { x, y },
-                .texCoords = { tx, ty },
-            };
-
-            sf::Vertex v1 = {
-                .position = { x, y + h },
-                .texCoords = { tx, ty + th },
-            };
-
-            sf::Vertex v2 = {
-                .position = { x + w, y },
-                .texCoords = { tx + tw, ty },
-            };
-
-            sf::Vertex v3 = {
-                .position = { x + w, y + h },
-                .texCoords = { tx + tw, ty + th },
-            };
-
-            // Triangle 1
-            vertexArrays[gz].push_back(v0);
-            vertexArrays[gz].push_back(v2);
-            vertexArrays[gz].push_back(v1);
-
-            // Triangle 2
-            vertexArrays[gz].push_back(v1);
-            vertexArrays[gz].push_back(v2);
-            vertexArrays[gz].push_back(v3);
+            for (int32_t spriteId : squares.squareTiles(squareIndex))
+            {
+                TexturePack::Texture *textureData = spriteDatas[spriteId];
+
+                if (textureData == nullptr)
+                    continue;
+
+                sf::Sprite sprite(atlasTexture);
+                rectpack2D::rect_xywh &rectangle = rectangles[spriteId];
+
+                float x = screenX + textureData->ox;
+                float y = screenY + textureData->oy;
+                float w = static_cast<float>(rectangle.w);
+                float h = static_cast<float>(rectangle.h);
+
+                float tx = static_cast<float>(rectangle.x);
+                float ty = static_cast<float>(rectangle.y);
+                float tw = static_cast<float>(rectangle.w);
+                float th = static_cast<float>(rectangle.h);
+
+                sf::Vertex v0 = {
+                    .position = { x, y },
+                    .texCoords = { tx, ty },
+                };
+
+                sf::Vertex v1 = {
+                    .position = { x, y + h },
+                    .texCoords = { tx, ty + th },
+                };
+
+                sf::Vertex v2 = {
+                    .position = { x + w, y },
+                    .texCoords = { tx + tw, ty },
+                };
+
+                sf::Vertex v3 = {
+                    .position = { x + w, y + h },
+                    .texCoords = { tx + tw, ty + th },
+                };
+
+                // Triangle 1
+                vertexArrays[gz].push_back(v0);
+                vertexArrays[gz].push_back(v2);
+                vertexArrays[gz].push_back(v1);
+
+                // Triangle 2
+                vertexArrays[gz].push_back(v1);
+                vertexArrays[gz].push_back(v2);
+                vertexArrays[gz].push_back(v3);
+            }
         }
-    }
+    });
 
     vertexBuffers.clear();
-    vertexBuffers.reserve(lotheader.maxLayer - lotheader.minLayer);
+    vertexBuffers.reserve(cell->header.maxLayer - cell->header.minLayer);
 
-    for (int layer = lotheader.minLayer; layer < lotheader.maxLayer; layer++)
+    for (int layer = cell->header.minLayer; layer < cell->header.maxLayer; layer++)
     {
         vertexBuffers[layer] = sf::VertexBuffer(sf::PrimitiveType::Triangles);
 
@@ -193,11 +201,55 @@ void CellViewer::preComputeSprites()
     }
 }
 
+bool CellViewer::loadVisibleChunks(const sf::View &view, int currentLayer)
+{
+    sf::Vector2f center = view.getCenter();
+    sf::Vector2f half = view.getSize() / 2.0f;
+
+    // squares drawn on upper layers are shifted up the screen, the bottom edge is extended to reach them
+    float top = center.y - half.y + std::min(currentLayer, 0) * constants::TILE_HEIGHT * 3;
+    float bottom = center.y + half.y + std::max(currentLayer, 0) * constants::TILE_HEIGHT * 3;
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    // inverse of the isometric projection used by preComputeSprites, on the view corners
+    for (float screenX : { center.x - half.x, center.x + half.x })
+    {
+        for (float screenY : { top, bottom })
+        {
+            float a = screenX / (constants::TILE_WIDTH / 2);
+            float b = screenY / (constants::TILE_HEIGHT / 2);
+            float gx = (a + b) / 2;
+            float gy = (b - a) / 2;
+
+            minX = std::min(minX, gx);
+            minY = std::min(minY, gy);
+            maxX = std::max(maxX, gx);
+            maxY = std::max(maxY, gy);
+        }
+    }
+
+    float originX = static_cast<float>(cell->header.position.x * constants::CELL_SIZE_IN_SQUARE);
+    float originY = static_cast<float>(cell->header.position.y * constants::CELL_SIZE_IN_SQUARE);
+
+    int chunkX0 = static_cast<int>(std::floor((minX - originX) / constants::BLOCK_SIZE_IN_SQUARE));
+    int chunkY0 = static_cast<int>(std::floor((minY - originY) / constants::BLOCK_SIZE_IN_SQUARE));
+    int chunkX1 = static_cast<int>(std::floor((maxX - originX) / constants::BLOCK_SIZE_IN_SQUARE));
+    int chunkY1 = static_cast<int>(std::floor((maxY - originY) / constants::BLOCK_SIZE_IN_SQUARE));
+
+    return cell->lotpack.loadChunks(chunkX0, chunkY0, chunkX1, chunkY1) > 0;
+}
+
 int CellViewer::update(sf::RenderWindow &window, int currentLayer)
 {
     int drawCalls = 0;
 
-    for (int layer = lotheader.minLayer; layer < lotheader.maxLayer; layer++)
+    if (cell->lotpack.isLazy() && loadVisibleChunks(window.getView(), currentLayer))
+    {
+        preComputeSprites();
+    }
+
+    for (int layer = cell->header.minLayer; layer < cell->header.maxLayer; layer++)
     {
         if (layer <= currentLayer)
         {
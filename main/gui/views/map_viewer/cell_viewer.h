@@ -2,22 +2,21 @@
 
 #include <SFML/Graphics/VertexBuffer.hpp>
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include <SFML/Graphics.hpp>
 
 #include "algorithms/rect_pack/rect_structs.h"
-#include "files/lotheader.h"
-#include "files/lotpack.h"
+#include "core/cell.h"
 #include "files/texturepack.h"
 #include "services/tilesheet_service.h"
 
 class CellViewer
 {
 private:
-    LotHeader lotheader;
-    Lotpack lotpack;
+    std::unique_ptr<Cell> cell;
 
     sf::Texture atlasTexture;
 
@@ -28,11 +27,14 @@ private:
 public:
     CellViewer(int x, int y, TilesheetService *tilesheetService);
 
-    int minLayer() { return lotheader.minLayer; }
-    int maxLayer() { return lotheader.maxLayer; }
+    int minLayer() { return cell->header.minLayer; }
+    int maxLayer() { return cell->header.maxLayer; }
 
     void packCellSprites(TilesheetService *tilesheetService);
     void preComputeSprites();
 
+    // decodes the chunks under the view, returns true when new ones were loaded
+    bool loadVisibleChunks(const sf::View &view, int currentLayer);
+
     int update(sf::RenderWindow &window, int currentLayer);
 };
\ No newline at end of file
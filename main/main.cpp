@@ -1,7 +1,11 @@
 #include <cpptrace/from_current.hpp>
 
 #include "cli/cmd_atlas_graph.h"
+#include "cli/cmd_map_archive.h"
+#include "cli/cmd_map_diff.h"
 #include "cli/cmd_map_viewer.h"
+#include "cli/cmd_spawn_map.h"
+#include "cli/cmd_sprite_index.h"
 #include "cli/cmd_tiles_browser.h"
 #include "cli/command_manager.h"
 #include <CLI/CLI.hpp>
@@ -20,7 +24,11 @@ int main(int argc, char **argv)
         CommandManager manager;
 
         manager.add<CmdAtlasGraph>();
+        manager.add<CmdMapArchive>();
+        manager.add<CmdMapDiff>();
         manager.add<CmdMapViewer>();
+        manager.add<CmdSpawnMap>();
+        manager.add<CmdSpriteIndex>();
         manager.add<CmdTilesBrowser>();
 
         manager.registerAll(app);
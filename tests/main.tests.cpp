@@ -32,7 +32,7 @@ TEST_CASE("readGameFiles")
     fmt::println("magic: {}, version: {}, md5: {}", lotpack.magic, lotpack.version, lotpackHash);
     fmt::println("magic: {}, version: {}", texturePack.magic, texturePack.version);
 
-    fmt::println("squareMap size: {}", lotpack.squareMap.size());
+    fmt::println("squares: {}", lotpack.squares.size());
     fmt::println("texture pages: {}", texturePack.pages.size());
     fmt::println("tilesheets: {}", tileDefinition.tileSheets.size());
 }
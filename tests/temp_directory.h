@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+
+// Uniquely named directory under the system temp directory, removed with its
+// contents when it goes out of scope, so a failed REQUIRE leaves nothing behind.
+class TempDirectory
+{
+public:
+    std::filesystem::path root;
+
+    explicit TempDirectory(const std::string &prefix)
+    {
+        static std::atomic<uint32_t> counter = 0;
+        std::random_device random;
+
+        do
+        {
+            root = std::filesystem::temp_directory_path() / (prefix + "_" + std::to_string(random()) + "_" + std::to_string(counter++));
+        } while (!std::filesystem::create_directory(root));
+    }
+
+    ~TempDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(root, error);
+    }
+
+    TempDirectory(const TempDirectory &) = delete;
+    TempDirectory &operator=(const TempDirectory &) = delete;
+
+    // Copies the files of the test cells into a subdirectory, so the files
+    // written next to a map directory (.pzmm, .cells) are removed with it.
+    std::filesystem::path copyCells(const std::string &name, const std::filesystem::path &source = "data/B42") const
+    {
+        std::filesystem::path directory = root / name;
+        std::filesystem::create_directories(directory);
+
+        for (const char *file : CELL_FILES)
+        {
+            std::filesystem::copy_file(source / file, directory / file);
+        }
+
+        return directory;
+    }
+
+private:
+    static constexpr const char *CELL_FILES[] = { "1_38.lotheader", "world_1_38.lotpack", "27_38.lotheader", "world_27_38.lotpack" };
+};
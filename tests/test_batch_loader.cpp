@@ -0,0 +1,51 @@
+#include <doctest/doctest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "io/batch_loader.h"
+#include "io/file_reader.h"
+#include "types.h"
+
+TEST_SUITE("BatchLoader")
+{
+    const std::vector<std::string> paths = {
+        "data/B42/27_38.lotheader",
+        "data/B42/world_27_38.lotpack",
+        "data/B42/1_38.lotheader",
+        "data/B42/world_1_38.lotpack",
+        "data/B42/newtiledefinitions.tiles",
+    };
+
+    TEST_CASE("every file is delivered once with its index")
+    {
+        // a single slot in flight forces workers to wait on the consumer
+        BatchLoader loader(3, 1);
+        std::vector<int> delivered(paths.size(), 0);
+
+        loader.load(paths, [&](size_t index, BytesBuffer &&buffer)
+        {
+            delivered[index]++;
+            CHECK(buffer == FileReader::read(paths[index]));
+        });
+
+        CHECK(delivered == std::vector<int>(paths.size(), 1));
+    }
+
+    TEST_CASE("errors are rethrown on the calling thread")
+    {
+        BatchLoader loader(2);
+
+        std::vector<std::string> missing = paths;
+        missing.insert(missing.begin() + 2, "data/B42/missing.lotheader");
+
+        CHECK_THROWS_AS(loader.load(missing, [](size_t, BytesBuffer &&) {}), std::runtime_error);
+        CHECK_THROWS_AS(loader.load(paths, [](size_t, BytesBuffer &&) { throw std::runtime_error("parse"); }), std::runtime_error);
+    }
+
+    TEST_CASE("empty batch")
+    {
+        BatchLoader loader;
+        loader.load({}, [](size_t, BytesBuffer &&) { FAIL("unexpected callback"); });
+    }
+}
@@ -1,3 +1,4 @@
+#include "io/binary_cursor.h"
 #include "io/binary_reader.h"
 #include <doctest/doctest.h>
 #include <stdexcept>
@@ -126,3 +127,98 @@ TEST_SUITE("BinaryReader")
             std::runtime_error);
     }
 }
+
+TEST_SUITE("BinaryCursor")
+{
+    TEST_CASE("views point into the source buffer")
+    {
+        BytesBuffer buf = { 'L', 'O', 'T', 'H', 5, 0, 0, 0, 'H', 'e', 'l', 'l', 'o', 'a', 'b', '\n' };
+        BinaryCursor cursor(buf);
+
+        std::string_view magic = cursor.readChars(4);
+        std::string_view hello = cursor.readStringWithLength();
+        std::string_view line = cursor.readLine();
+
+        CHECK(magic == "LOTH");
+        CHECK(hello == "Hello");
+        CHECK(line == "ab");
+        CHECK(reinterpret_cast<const uint8_t *>(hello.data()) == buf.data() + 8);
+        CHECK(cursor.eof());
+    }
+
+    TEST_CASE("byte ranges")
+    {
+        BytesBuffer buf = { 2, 0, 0, 0, 7, 8, 1, 2, 3, 0xAA, 0xBB, 9 };
+        BinaryCursor cursor(buf);
+
+        BytesView bytes = cursor.readBytesWithLength();
+        CHECK(bytes.size() == 2);
+        CHECK(bytes.data() == buf.data() + 4);
+
+        const uint8_t pattern[] = { 0xAA, 0xBB };
+        BytesView slice = cursor.readUntil(pattern);
+        CHECK(slice.size() == 3);
+        CHECK(slice[0] == 1);
+        CHECK(cursor.tell() == 11);
+
+        CHECK(cursor.readExact(1)[0] == 9);
+        CHECK_THROWS_AS(cursor.readExact(1), std::runtime_error);
+    }
+
+    TEST_CASE("out of bounds access")
+    {
+        BytesBuffer buf = { 0xFF, 0xFF, 0xFF, 0xFF, 'a' };
+        BinaryCursor cursor(buf);
+
+        // negative length prefix
+        CHECK_THROWS_AS(cursor.readStringWithLength(), std::runtime_error);
+        CHECK_THROWS_AS(cursor.seek(6), std::runtime_error);
+
+        cursor.seek(4);
+        CHECK_THROWS_AS(cursor.readLine(), std::runtime_error);
+        CHECK_THROWS_AS(cursor.readInt32(), std::runtime_error);
+    }
+}
+
+TEST_CASE("readInt32Array")
+{
+    BytesBuffer buf = { 0x78, 0x56, 0x34, 0x12, 0xFF, 0xFF, 0xFF, 0xFF, 2, 0, 0, 0 };
+
+    SUBCASE("values")
+    {
+        size_t offset = 0;
+        int32_t values[3];
+
+        BinaryReader::readInt32Array(buf, values, offset);
+        CHECK(values[0] == 0x12345678);
+        CHECK(values[1] == -1);
+        CHECK(values[2] == 2);
+        CHECK(offset == 12);
+    }
+
+    SUBCASE("structs")
+    {
+        struct Pair
+        {
+            uint32_t a;
+            int32_t b;
+        };
+
+        BinaryCursor cursor(buf, 4);
+        Pair pair[1];
+
+        cursor.readInt32Array(std::span(pair));
+        CHECK(pair[0].a == 0xFFFFFFFF);
+        CHECK(pair[0].b == 2);
+        CHECK(cursor.eof());
+    }
+
+    SUBCASE("bounds are checked once for the whole array")
+    {
+        size_t offset = 4;
+        int32_t values[3];
+
+        CHECK_THROWS_AS(BinaryReader::readInt32Array(buf, values, offset), std::runtime_error);
+        CHECK(offset == 4);
+    }
+}
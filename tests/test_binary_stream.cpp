@@ -0,0 +1,94 @@
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "files/texturepack.h"
+#include "io/binary_stream.h"
+#include "io/binary_writer.h"
+#include "io/file_reader.h"
+#include "types.h"
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("BinaryStream")
+{
+    TEST_CASE("reads across chunk boundaries")
+    {
+        static constexpr uint8_t PATTERN[] = { 0xEF, 0xBE, 0xAD, 0xDE };
+
+        BinaryWriter writer(4 + 4 + 7 + 25 + 4 + 3);
+        writer.writeInt32(7);
+        writer.writeStringWithLength("texture");
+        writer.writeChars("payload spanning chunks.");
+        writer.writeChars("!");
+        writer.writeBytes(PATTERN);
+        writer.writeChars("end");
+
+        fs::path path = fs::temp_directory_path() / "binary_stream_test.bin";
+        FileReader::save(writer.finish(), path.string());
+
+        // every chunk size splits the fields and the pattern at a different place
+        for (size_t chunkSize : { 16, 17, 18, 19, 64 })
+        {
+            BinaryStream stream(path.string(), chunkSize);
+            BytesBuffer payload;
+
+            CHECK(stream.readInt32() == 7);
+            CHECK(stream.readStringWithLength() == "texture");
+
+            stream.readUntil(PATTERN, payload);
+            CHECK(std::string(payload.begin(), payload.end()) == "payload spanning chunks.!");
+            CHECK(stream.readChars(3) == "end");
+            CHECK(stream.eof());
+            CHECK(stream.tell() == fs::file_size(path));
+            CHECK_THROWS_AS(stream.readInt32(), std::runtime_error);
+        }
+
+        fs::remove(path);
+    }
+
+    TEST_CASE("TexturePack pages are streamed one at a time")
+    {
+        for (uint32_t version : { 0u, 1u })
+        {
+            TexturePack texturePack{};
+            texturePack.magic = "PZPK";
+            texturePack.version = version;
+
+            for (int i = 0; i < 3; i++)
+            {
+                TexturePack::Page page{};
+                page.name = "page_" + std::to_string(i);
+                page.hasAlpha = i % 2;
+                page.textures = { TexturePack::Texture{ "tile_" + std::to_string(i), 0, i, i, 1, 1, 0, 0, 1, 1 } };
+                page.png = BytesBuffer(100 + i * 50, static_cast<uint8_t>(i));
+
+                texturePack.pages.push_back(page);
+            }
+
+            fs::path path = fs::temp_directory_path() / "texturepack_stream_test.pack";
+            texturePack.save(path.string());
+
+            size_t pageIndex = 0;
+            TexturePack streamed = TexturePack::stream(path, [&](const TexturePack::Page &page)
+            {
+                const TexturePack::Page &expected = texturePack.pages[pageIndex++];
+
+                CHECK(page.name == expected.name);
+                CHECK(page.hasAlpha == expected.hasAlpha);
+                REQUIRE(page.textures.size() == 1);
+                CHECK(page.textures[0].name == expected.textures[0].name);
+                CHECK(page.textures[0].x == expected.textures[0].x);
+                CHECK(page.png == expected.png);
+            }, 32);
+
+            CHECK(pageIndex == 3);
+            CHECK(streamed.version == version);
+            CHECK(streamed.pages.empty());
+
+            fs::remove(path);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#include <array>
+#include <doctest/doctest.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "files/texturepack.h"
+#include "files/tiledefinition.h"
+#include "io/binary_cursor.h"
+#include "io/binary_writer.h"
+#include "io/file_reader.h"
+#include "math/md5.h"
+#include "types.h"
+
+// 1x1 RGBA image
+static const BytesBuffer PNG_1x1 = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4,
+    0x89, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0xF8, 0xCF, 0xC0, 0xF0,
+    0x1F, 0x00, 0x05, 0x00, 0x01, 0xFF, 0x89, 0x99, 0x3D, 0x1D, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45,
+    0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+};
+
+TEST_SUITE("BinaryWriter")
+{
+    TEST_CASE("primitives are read back by BinaryCursor")
+    {
+        std::array<int32_t, 3> values = { 1, -2, 3 };
+
+        BinaryWriter writer(4 + 5 + 3 * 4 + 4 + 2);
+        writer.writeInt32(0);
+        writer.writeLine("tdef");
+        writer.writeInt32Array(std::span(values));
+        writer.writeStringWithLength("ab");
+        writer.patchInt32(0, 42);
+
+        BytesBuffer buffer = writer.finish();
+        BinaryCursor cursor(buffer);
+
+        CHECK(cursor.readInt32() == 42);
+        CHECK(cursor.readLine() == "tdef");
+
+        std::array<int32_t, 3> decoded{};
+        cursor.readInt32Array(std::span(decoded));
+        CHECK(decoded == values);
+
+        CHECK(cursor.readStringWithLength() == "ab");
+        CHECK(cursor.eof());
+    }
+
+    TEST_CASE("capacity mismatch throws")
+    {
+        BinaryWriter overflow(2);
+        CHECK_THROWS_AS(overflow.writeInt32(1), std::runtime_error);
+
+        BinaryWriter underflow(8);
+        underflow.writeInt32(1);
+        CHECK_THROWS_AS(underflow.finish(), std::runtime_error);
+    }
+
+    TEST_CASE("round trip")
+    {
+        SUBCASE("lotheader and lotpack")
+        {
+            for (const char *directory : { "data/B41", "data/B42" })
+            {
+                BytesBuffer headerBuffer = FileReader::read(std::string(directory) + "/27_38.lotheader");
+                BytesBuffer lotpackBuffer = FileReader::read(std::string(directory) + "/world_27_38.lotpack");
+
+                LotHeader header = LotHeader::read(headerBuffer, Vector2i(27, 38));
+                Lotpack lotpack = Lotpack::read(lotpackBuffer, &header);
+
+                CHECK(header.isB41() == (std::string_view(directory) == "data/B41"));
+                CHECK(lotpack.isB41() == header.isB41());
+
+                CHECK(header.serializedSize() == headerBuffer.size());
+                CHECK(MD5::toHash(header.write()) == MD5::toHash(headerBuffer));
+
+                CHECK(lotpack.serializedSize() == lotpackBuffer.size());
+
+                // blocks are encoded on parallel workers, the output must not depend on their count
+                for (size_t threads : { 1, 4 })
+                {
+                    CHECK(MD5::toHash(lotpack.write(threads)) == MD5::toHash(lotpackBuffer));
+                }
+            }
+        }
+
+        SUBCASE("lotpack squares without tiles")
+        {
+            LotHeader header = LotHeader::read("data/B42/27_38.lotheader");
+            Lotpack lotpack = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+
+            // one square keeps its position and room but loses its tiles
+            Lotpack::SquareTable original = std::move(lotpack.squares);
+            size_t emptied = original.size() / 2;
+
+            lotpack.squares = {};
+            for (size_t square = 0; square < original.size(); square++)
+            {
+                std::span<const int32_t> tiles = square == emptied ? std::span<const int32_t>() : original.squareTiles(square);
+                lotpack.squares.push(original.coords[square], original.roomIds[square], tiles);
+            }
+
+            BytesBuffer buffer = lotpack.write();
+            CHECK(buffer.size() == lotpack.serializedSize());
+
+            Lotpack decoded = Lotpack::read(buffer, &header);
+            REQUIRE(decoded.squares.size() == original.size() - 1);
+            CHECK(decoded.squares.coords[emptied] == original.coords[emptied + 1]);
+            CHECK(decoded.squares.tiles.size() == original.tiles.size() - original.squareTiles(emptied).size());
+        }
+
+        SUBCASE("tile definitions")
+        {
+            for (const char *path : { "data/B41/newtiledefinitions.tiles", "data/B42/newtiledefinitions.tiles" })
+            {
+                BytesBuffer buffer = FileReader::read(path);
+                TileDefinition tileDefinition = TileDefinition::read("newtiledefinitions", buffer);
+
+                CHECK(tileDefinition.serializedSize() == buffer.size());
+                CHECK(MD5::toHash(tileDefinition.write()) == MD5::toHash(buffer));
+            }
+        }
+
+        SUBCASE("texturepack")
+        {
+            for (uint32_t version : { 0u, 1u })
+            {
+                TexturePack::Texture texture{ "tile_0", 0, 0, 0, 1, 1, 0, 0, 1, 1 };
+
+                TexturePack::Page page{};
+                page.version = version;
+                page.name = "page_0";
+                page.hasAlpha = 1;
+                page.textures = { texture };
+                page.png = PNG_1x1;
+                REQUIRE(page.image.loadFromMemory(page.png.data(), page.png.size()));
+
+                TexturePack texturePack{};
+                texturePack.magic = "PZPK";
+                texturePack.version = version;
+                texturePack.pages = { page };
+
+                BytesBuffer buffer = texturePack.write();
+                CHECK(buffer.size() == texturePack.serializedSize());
+
+                TexturePack decoded = TexturePack::read("texturepack", buffer, true);
+                REQUIRE(decoded.pages.size() == 1);
+                CHECK(decoded.version == version);
+                CHECK(decoded.pages[0].name == "page_0");
+                CHECK(decoded.pages[0].hasAlpha == 1);
+                CHECK(decoded.pages[0].textures[0].name == "tile_0");
+                CHECK(decoded.pages[0].png == PNG_1x1);
+                CHECK(MD5::toHash(decoded.write()) == MD5::toHash(buffer));
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <doctest/doctest.h>
+
+#include "io/byte_scanner.h"
+#include "types.h"
+
+TEST_SUITE("ByteScanner")
+{
+    TEST_CASE("single byte")
+    {
+        BytesBuffer buf = { 'a', 'b', '\n', 'c', '\n' };
+
+        CHECK(ByteScanner::find(buf, '\n') == 2);
+        CHECK(ByteScanner::find(buf, '\n', 3) == 4);
+        CHECK(ByteScanner::find(buf, 'z') == ByteScanner::npos);
+        CHECK(ByteScanner::find(buf, 'a', 5) == ByteScanner::npos);
+    }
+
+    TEST_CASE("4 bytes sentinel at every position")
+    {
+        const uint8_t sentinel[] = { 0xEF, 0xBE, 0xAD, 0xDE };
+
+        // covers matches inside the vectorized loop, across its boundaries and in the scalar tail
+        for (size_t size = 4; size < 70; size++)
+        {
+            for (size_t position = 0; position + 4 <= size; position++)
+            {
+                BytesBuffer buf(size, 0xEF);
+                std::copy(std::begin(sentinel), std::end(sentinel), buf.begin() + position);
+
+                CHECK(ByteScanner::find(buf, sentinel) == position);
+                CHECK(ByteScanner::find(buf, sentinel, position + 1) == ByteScanner::npos);
+            }
+        }
+    }
+
+    TEST_CASE("other pattern sizes")
+    {
+        BytesBuffer buf = { 1, 2, 1, 2, 3, 1, 2, 3 };
+        BytesBuffer pattern = { 1, 2, 3 };
+
+        CHECK(ByteScanner::find(buf, pattern) == 2);
+        CHECK(ByteScanner::find(buf, pattern, 3) == 5);
+        CHECK(ByteScanner::find(buf, pattern, 6) == ByteScanner::npos);
+        CHECK(ByteScanner::find(buf, BytesBuffer{ 3 }) == 4);
+    }
+}
@@ -0,0 +1,238 @@
+#include <cstring>
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/sprite_index.h"
+#include "files/cell_cache.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "files/map_manifest.h"
+#include "io/file_reader.h"
+#include "math/fingerprint.h"
+#include "services/map_files_service.h"
+#include "temp_directory.h"
+#include "types.h"
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("CellCache")
+{
+    TEST_CASE("mapped arrays match the decoded lotpack")
+    {
+        TempDirectory temp("cell_cache_test");
+        fs::path cacheDirectory = temp.root;
+
+        for (const char *directory : { "data/B41", "data/B42" })
+        {
+            std::string lotheaderPath = std::string(directory) + "/27_38.lotheader";
+            std::string lotpackPath = std::string(directory) + "/world_27_38.lotpack";
+
+            LotHeader header = LotHeader::read(lotheaderPath, LotHeader::SECTION_TILE_NAMES);
+            Lotpack lotpack = Lotpack::read(lotpackPath, &header);
+
+            Fingerprint::Hash128 lotheaderHash = Fingerprint::file(lotheaderPath);
+            std::string path = CellCache::cachePath(cacheDirectory.string(), header.position, lotheaderHash, Fingerprint::file(lotpackPath));
+            BytesBuffer buffer = CellCache::write(header, lotpack, lotheaderHash, Fingerprint::file(lotpackPath));
+            CHECK(buffer.size() == CellCache::serializedSize(header, lotpack));
+            FileReader::save(buffer, path);
+
+            CellCache cache = CellCache::open(path);
+            CHECK(cache.isB41() == header.isB41());
+            CHECK(cache.position.y == 38);
+            CHECK(cache.lotpackHash == Fingerprint::file(lotpackPath));
+            CHECK(cache.blocksCount == lotpack.blocksCount);
+            CHECK(cache.tileIds == header.tileIds);
+
+            REQUIRE(cache.squaresCount() == lotpack.squares.size());
+            CHECK(std::ranges::equal(cache.getCoords(), lotpack.squares.coords));
+            CHECK(std::ranges::equal(cache.getRoomIds(), lotpack.squares.roomIds));
+            CHECK(std::ranges::equal(cache.getTileOffsets(), lotpack.squares.tileOffsets));
+            CHECK(std::ranges::equal(cache.getTiles(), lotpack.squares.tiles));
+
+            auto [first, last] = cache.blockSquares(cache.blocksCount - 1);
+            CHECK(last == cache.squaresCount());
+            CHECK(first <= last);
+
+            // the mapped arrays are the decoded form, the lotpack is encoded back byte for byte
+            auto shared = std::make_shared<const CellCache>(std::move(cache));
+            Lotpack mapped = CellCache::mapLotpack(shared, &header);
+            CHECK(mapped.isMapped());
+            CHECK(mapped.view().tiles.data() == shared->getTiles().data());
+            CHECK(mapped.write() == FileReader::read(lotpackPath));
+            CHECK(mapped.blockHashes() == lotpack.blockHashes());
+        }
+    }
+
+    TEST_CASE("lazy mapped lotpacks visit loaded blocks")
+    {
+        TempDirectory temp("cell_cache_lazy");
+        std::string path = (temp.root / "lazy.pzcc").string();
+
+        LotHeader header = LotHeader::read("data/B42/27_38.lotheader", LotHeader::SECTION_TILE_NAMES);
+        Lotpack decoded = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+        FileReader::save(CellCache::write(header, decoded, {}, {}), path);
+
+        Lotpack lazy = CellCache::mapLotpack(std::make_shared<const CellCache>(CellCache::open(path)), &header, true);
+        REQUIRE(lazy.isLazy());
+
+        size_t visited = 0;
+        lazy.forEachLoadedTable([&](const Lotpack::SquareView &squares) { visited += squares.size(); });
+        CHECK(visited == 0);
+
+        CHECK(lazy.loadChunks(0, 0, 1, 0) == 2);
+        CHECK(lazy.loadChunks(0, 0, 1, 0) == 0);
+        CHECK(lazy.isBlockLoaded(Lotpack::blockIndex(1, 0)));
+        CHECK_FALSE(lazy.isBlockLoaded(Lotpack::blockIndex(2, 0)));
+
+        std::vector<CellCoord> coords;
+        lazy.forEachLoadedTable([&](const Lotpack::SquareView &squares)
+        {
+            for (size_t square = 0; square < squares.size(); square++)
+            {
+                coords.push_back(squares.coords[square]);
+                CHECK(squares.squareTiles(square).size() == squares.tileOffsets[square + 1] - squares.tileOffsets[square]);
+            }
+        });
+
+        std::vector<CellCoord> expected;
+        for (CellCoord coord : decoded.squares.coords)
+        {
+            if (coord.chunk_idx() == Lotpack::blockIndex(0, 0) || coord.chunk_idx() == Lotpack::blockIndex(1, 0))
+                expected.push_back(coord);
+        }
+
+        CHECK(coords == expected);
+
+        // the whole cell stays readable
+        CHECK(lazy.view().size() == decoded.squares.size());
+        CHECK(lazy.write() == FileReader::read("data/B42/world_27_38.lotpack"));
+    }
+
+    TEST_CASE("invalid files throw")
+    {
+        TempDirectory temp("cell_cache_invalid");
+        fs::path path = temp.root / "invalid.pzcc";
+
+        LotHeader header = LotHeader::read("data/B42/27_38.lotheader", LotHeader::SECTION_TILE_NAMES);
+        Lotpack lotpack = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+        BytesBuffer buffer = CellCache::write(header, lotpack, {}, {});
+
+        FileReader::save(BytesBuffer(buffer.begin(), buffer.begin() + buffer.size() / 2), path.string());
+        CHECK_THROWS_AS(CellCache::open(path.string()), std::runtime_error);
+
+        // a tile offset in the middle pointing past the tiles
+        BytesBuffer corrupted = buffer;
+        size_t tileOffsetsStart = CellCache::HEADER_SIZE + (lotpack.blocksCount + 1 + 2 * lotpack.squares.size()) * 4;
+        uint32_t pastTiles = static_cast<uint32_t>(lotpack.squares.tiles.size() + 100);
+        std::memcpy(corrupted.data() + tileOffsetsStart + lotpack.squares.size() / 2 * 4, &pastTiles, 4);
+        FileReader::save(corrupted, path.string());
+        CHECK_THROWS_AS(CellCache::open(path.string()), std::runtime_error);
+
+        // a tile past the lotheader tile names
+        corrupted = buffer;
+        uint32_t pastNames = static_cast<uint32_t>(header.tileIds.size());
+        std::memcpy(corrupted.data() + tileOffsetsStart + (lotpack.squares.size() + 1) * 4 + lotpack.squares.tiles.size() / 2 * 4, &pastNames, 4);
+        FileReader::save(corrupted, path.string());
+        CHECK_THROWS_AS(CellCache::open(path.string()), std::runtime_error);
+
+        // a square moved to another block
+        corrupted = buffer;
+        size_t coordsStart = CellCache::HEADER_SIZE + (lotpack.blocksCount + 1) * 4;
+        uint32_t movedCoord = CellCoord(static_cast<uint16_t>(lotpack.blocksCount - 1), 0, 0, 0).getPacked();
+        std::memcpy(corrupted.data() + coordsStart, &movedCoord, 4);
+        FileReader::save(corrupted, path.string());
+        CHECK_THROWS_AS(CellCache::open(path.string()), std::runtime_error);
+
+        buffer[0] = 'X';
+        FileReader::save(buffer, path.string());
+        CHECK_THROWS_AS(CellCache::open(path.string()), std::runtime_error);
+    }
+
+    TEST_CASE("stale caches are rebuilt")
+    {
+        TempDirectory temp("cell_cache_load_test");
+        fs::path cacheDirectory = temp.root / "cells";
+
+        MapManifest manifest = MapManifest::scan("data/B42");
+        REQUIRE(manifest.cells.size() == 2);
+        MapManifest::Cell cell = manifest.cells[1];
+
+        CellCache cache = CellCache::load(manifest, cell, cacheDirectory.string());
+        std::string path = CellCache::cachePath(cacheDirectory.string(), cell);
+        REQUIRE(fs::exists(path));
+        CHECK(cache.matches(cell));
+
+        // an up to date cache is mapped as is
+        auto written = fs::last_write_time(path);
+        CHECK(CellCache::load(manifest, cell, cacheDirectory.string()).squaresCount() == cache.squaresCount());
+        CHECK(fs::last_write_time(path) == written);
+
+        // a new version gets its own file, the mapped one is never replaced
+        cell.lotpack.hash.low ^= 1;
+        CHECK_FALSE(cache.matches(cell));
+        std::string rebuiltPath = CellCache::cachePath(cacheDirectory.string(), cell);
+        CHECK(rebuiltPath != path);
+        CellCache rebuilt = CellCache::load(manifest, cell, cacheDirectory.string());
+        CHECK(rebuilt.matches(cell));
+        CHECK(fs::exists(rebuiltPath));
+        CHECK(std::ranges::equal(rebuilt.getTiles(), cache.getTiles()));
+
+        // the sprite index reads the same squares from the caches
+        CHECK(SpriteIndex::build(manifest, 0, cacheDirectory.string()).write() == SpriteIndex::build(manifest).write());
+    }
+
+    TEST_CASE("MapFilesService maps cells from the cache")
+    {
+        TempDirectory temp("cell_cache_service");
+        fs::path gamePath = temp.root;
+        fs::path mapDirectory = temp.copyCells("media/maps/test");
+
+        LotHeader header = LotHeader::read("data/B42/27_38.lotheader");
+        Lotpack decoded = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+        MapManifest manifest = MapManifest::scan(mapDirectory.string());
+        std::string cacheDirectory = (temp.root / "cells").string();
+
+        // the default location is per user, never next to the game files
+        std::string defaultDirectory = CellCache::defaultDirectory(mapDirectory.string());
+        CHECK_FALSE(defaultDirectory.starts_with(gamePath.string()));
+        CHECK(defaultDirectory != CellCache::defaultDirectory((temp.root / "other" / "test").string()));
+
+        {
+            MapFilesService service(gamePath.string(), "test");
+            REQUIRE(service.UseCellCache(cacheDirectory));
+
+            std::unique_ptr<Cell> cell = service.LoadCellByPosition(27, 38);
+            CHECK(fs::exists(CellCache::cachePath(cacheDirectory, manifest.cells[1])));
+            CHECK(cell->lotpack.header == &cell->header);
+            CHECK(cell->lotpack.isMapped());
+            CHECK(cell->header.tileIds == header.tileIds);
+            CHECK(std::ranges::equal(cell->lotpack.view().tiles, decoded.squares.tiles));
+            CHECK(cell->lotpack.write() == FileReader::read("data/B42/world_27_38.lotpack"));
+
+            // opened cells stay lazy, the header has only the requested sections
+            std::unique_ptr<Cell> opened = service.OpenCellByPosition(27, 38, LotHeader::SECTION_TILE_NAMES);
+            CHECK(opened->lotpack.isLazy());
+            CHECK_FALSE(opened->lotpack.isBlockLoaded(0));
+            CHECK(opened->header.hasSections(LotHeader::SECTION_TILE_NAMES));
+            CHECK_FALSE(opened->header.hasSections(LotHeader::SECTION_ROOMS));
+            CHECK(opened->header.tileName(0) == header.tileName(0));
+
+            service.LoadMapFiles();
+            REQUIRE(service.getLotpackByPosition(1, 38) != nullptr);
+            CHECK(std::ranges::equal(service.getLotpackByPosition(27, 38)->view().coords, decoded.squares.coords));
+            CHECK(fs::exists(CellCache::cachePath(cacheDirectory, manifest.cells[0])));
+        }
+
+        // a directory that can't be created disables the cache, cells are still loaded
+        FileReader::save(BytesBuffer(), (temp.root / "file").string());
+
+        {
+            MapFilesService service(gamePath.string(), "test");
+            CHECK_FALSE(service.UseCellCache((temp.root / "file" / "cells").string()));
+            CHECK(service.LoadCellByPosition(27, 38)->lotpack.squares.tiles == decoded.squares.tiles);
+        }
+    }
+}
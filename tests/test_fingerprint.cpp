@@ -0,0 +1,107 @@
+#include <doctest/doctest.h>
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io/file_reader.h"
+#include "math/fingerprint.h"
+#include "math/md5.h"
+#include "types.h"
+
+namespace fs = std::filesystem;
+
+static BytesView bytesOf(std::string_view text)
+{
+    return BytesView(reinterpret_cast<const uint8_t *>(text.data()), text.size());
+}
+
+TEST_SUITE("Fingerprint")
+{
+    TEST_CASE("XXH64 reference values")
+    {
+        CHECK(Fingerprint::hash64(bytesOf("")) == 0xEF46DB3751D8E999ULL);
+        CHECK(Fingerprint::hash64(bytesOf("a")) == 0xD24EC4F1A98C6E5BULL);
+        CHECK(Fingerprint::hash64(bytesOf("abc")) == 0x44BC2CF5AD770999ULL);
+    }
+
+    TEST_CASE("incremental updates match a single pass")
+    {
+        BytesBuffer buffer = FileReader::read("data/B42/27_38.lotheader");
+        Fingerprint::Hash128 expected = Fingerprint::hash128(buffer);
+
+        // odd split sizes exercise the partial stripe paths
+        for (size_t step : { 1, 7, 31, 32, 33, 4096 })
+        {
+            Fingerprint::Hasher128 hasher;
+            for (size_t offset = 0; offset < buffer.size(); offset += step)
+            {
+                hasher.update(BytesView(buffer).subspan(offset, std::min(step, buffer.size() - offset)));
+            }
+
+            CHECK(hasher.digest() == expected);
+        }
+
+        CHECK(Fingerprint::file("data/B42/27_38.lotheader") == expected);
+        CHECK(expected.low != expected.high);
+    }
+
+    TEST_CASE("directory fingerprint follows content")
+    {
+        fs::path directory = fs::temp_directory_path() / "fingerprint_test";
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+
+        fs::copy_file("data/B42/27_38.lotheader", directory / "27_38.lotheader");
+        fs::copy_file("data/B42/1_38.lotheader", directory / "1_38.lotheader");
+        FileReader::save({ 1, 2, 3 }, (directory / "notes.txt").string());
+
+        std::array<std::string_view, 1> extensions = { ".lotheader" };
+        Fingerprint::Hash128 initial = Fingerprint::directory(directory.string(), extensions);
+
+        CHECK(Fingerprint::directory(directory.string(), extensions) == initial);
+        CHECK(Fingerprint::directory(directory.string()) != initial);
+
+        fs::copy_file("data/B42/27_38.lotheader", directory / "1_38.lotheader", fs::copy_options::overwrite_existing);
+        CHECK(Fingerprint::directory(directory.string(), extensions) != initial);
+
+        fs::remove_all(directory);
+    }
+}
+
+TEST_SUITE("MD5")
+{
+    TEST_CASE("multiple buffers hash as their concatenation")
+    {
+        CHECK(MD5::toHash(bytesOf("abc")) == "900150983cd24fb0d6963f7d28e17f72");
+
+        std::array<BytesView, 3> parts = { bytesOf("a"), bytesOf(""), bytesOf("bc") };
+        CHECK(MD5::toHash(parts) == "900150983cd24fb0d6963f7d28e17f72");
+
+        BytesBuffer buffer = FileReader::read("data/B42/world_27_38.lotpack");
+        std::array<BytesView, 2> halves = { BytesView(buffer).first(1000), BytesView(buffer).subspan(1000) };
+        CHECK(MD5::toHash(halves) == MD5::toHash(buffer));
+    }
+
+    TEST_CASE("independent buffers hash separately")
+    {
+        BytesBuffer buffer = FileReader::read("data/B42/world_27_38.lotpack");
+        BytesView bytes(buffer);
+
+        // sizes around the one and two padding blocks limits, more buffers than lanes
+        std::vector<BytesView> messages = { bytesOf("abc"), bytesOf(""), bytes.first(55), bytes.first(56), bytes.first(64), bytes.first(119), bytes, bytes.subspan(3) };
+        std::vector<std::string> hashes = MD5::toHashes(messages);
+
+        REQUIRE(hashes.size() == messages.size());
+        CHECK(hashes[0] == "900150983cd24fb0d6963f7d28e17f72");
+        CHECK(hashes[1] == "d41d8cd98f00b204e9800998ecf8427e");
+
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            CHECK(hashes[i] == MD5::toHash(messages[i]));
+        }
+
+        CHECK(MD5::toHashes({}).empty());
+    }
+}
@@ -1,6 +1,7 @@
 #define DOCTEST_CONFIG_NO_CAPTURE_STDOUT
 
 #include <filesystem>
+#include <optional>
 #include <string>
 
 #include <doctest/doctest.h>
@@ -8,6 +9,7 @@
 
 #include "math/vector2i.h"
 #include <constants.h>
+#include <exceptions.h>
 #include <files/lotheader.h>
 #include <io/file_reader.h>
 #include <math/md5.h>
@@ -85,4 +87,97 @@ TEST_CASE("getPositionFromFilename")
     {
         CHECK_THROWS_AS(LotHeader::getPositionFromFilename("10_20.txt"), std::runtime_error);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("validate")
+{
+    BytesBuffer buffer = FileReader::read(constants::LOTHEADER_PATH);
+
+    SUBCASE("vanilla file takes the unchecked path")
+    {
+        CHECK(LotHeader::validate(buffer));
+    }
+
+    SUBCASE("truncated file is rejected and parsing still throws")
+    {
+        buffer.resize(buffer.size() / 2);
+
+        CHECK_FALSE(LotHeader::validate(buffer));
+        CHECK_THROWS_AS(LotHeader::read(buffer, Vector2i(0, 0)), std::runtime_error);
+    }
+
+    SUBCASE("trailing bytes are rejected")
+    {
+        buffer.push_back(0);
+
+        CHECK_FALSE(LotHeader::validate(buffer));
+        CHECK_THROWS_AS(LotHeader::read(buffer, Vector2i(0, 0)), Exceptions::FileEndNotReached);
+    }
+}
+
+TEST_CASE("room table ranges")
+{
+    LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+    const LotHeader::RoomTable &rooms = header.rooms;
+
+    REQUIRE(rooms.roomsCount() > 0);
+    REQUIRE(rooms.buildingsCount() > 0);
+
+    CHECK(rooms.nameOffsets.back() == rooms.names.size());
+    CHECK(rooms.rectangleOffsets.back() == rooms.rectangles.size());
+    CHECK(rooms.objectOffsets.back() == rooms.roomObjects.size());
+    CHECK(rooms.buildingRoomOffsets.back() == rooms.buildingRoomIds.size());
+
+    for (size_t i = 0; i < rooms.roomsCount(); i++)
+    {
+        uint32_t area = 0;
+        for (const LotHeader::Rectangle &rect : rooms.roomRectangles(i))
+        {
+            area += rect.width * rect.heigth;
+        }
+
+        CHECK(rooms.areas[i] == area);
+        CHECK_FALSE(rooms.roomName(i).empty());
+    }
+
+    for (size_t i = 0; i < rooms.buildingsCount(); i++)
+    {
+        for (uint32_t roomId : rooms.buildingRooms(i))
+        {
+            CHECK(roomId < rooms.roomsCount());
+        }
+    }
+}
+
+TEST_CASE("section-selective read")
+{
+    BytesBuffer buffer = FileReader::read(constants::LOTHEADER_PATH);
+    LotHeader full = LotHeader::read(buffer, Vector2i(27, 38));
+
+    std::optional<LotHeader::SectionIndex> index = LotHeader::indexSections(buffer);
+    REQUIRE(index.has_value());
+    CHECK(index->tileNames < index->dimensions);
+    CHECK(index->dimensions < index->rooms);
+    CHECK(index->rooms < index->buildings);
+    CHECK(index->buildings < index->spawns);
+    CHECK(index->spawns + constants::BLOCKS_PER_CELL == buffer.size());
+
+    LotHeader header = LotHeader::read(buffer, Vector2i(27, 38), LotHeader::SECTION_TILE_NAMES);
+
+    CHECK(header.hasSections(LotHeader::SECTION_TILE_NAMES));
+    CHECK_FALSE(header.hasSections(LotHeader::SECTION_ROOMS));
+    CHECK(header.tileIds == full.tileIds);
+    CHECK(header.minLayer == full.minLayer);
+    CHECK(header.maxLayer == full.maxLayer);
+    CHECK(header.rooms.roomsCount() == 0);
+    CHECK(header.spawns.empty());
+    CHECK_THROWS_AS(header.write(), std::runtime_error);
+
+    header.load(buffer, LotHeader::SECTION_ROOMS | LotHeader::SECTION_BUILDINGS | LotHeader::SECTION_SPAWNS);
+    header.load(buffer, LotHeader::SECTION_ROOMS);
+
+    CHECK(header.hasSections(LotHeader::SECTION_ALL));
+    CHECK(header.rooms.names == full.rooms.names);
+    CHECK(header.rooms.buildingRoomIds == full.rooms.buildingRoomIds);
+    CHECK(header.spawns == full.spawns);
+    CHECK(header.write() == buffer);
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <optional>
+#include <stdexcept>
+
+#include "constants.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "io/file_reader.h"
+#include "types.h"
+
+TEST_SUITE("Lotpack")
+{
+    TEST_CASE("validate")
+    {
+        LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+        BytesBuffer buffer = FileReader::read(constants::LOTHPACK_PATH);
+
+        SUBCASE("vanilla file takes the unchecked path")
+        {
+            CHECK(Lotpack::validate(buffer, &header));
+        }
+
+        SUBCASE("corrupted block offset is rejected and parsing still throws")
+        {
+            // first entry of the block offset table
+            buffer[12] = 0xFF;
+            buffer[13] = 0xFF;
+            buffer[14] = 0xFF;
+            buffer[15] = 0x7F;
+
+            CHECK_FALSE(Lotpack::validate(buffer, &header));
+            CHECK_THROWS_AS(Lotpack::read(buffer, &header), std::runtime_error);
+        }
+
+        SUBCASE("truncated file is rejected")
+        {
+            buffer.resize(buffer.size() - 4);
+
+            CHECK_FALSE(Lotpack::validate(buffer, &header));
+            CHECK_THROWS_AS(Lotpack::read(buffer, &header), std::runtime_error);
+        }
+    }
+
+    TEST_CASE("square table")
+    {
+        LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+        BytesBuffer buffer = FileReader::read(constants::LOTHPACK_PATH);
+        Lotpack lotpack = Lotpack::read(buffer, &header);
+
+        const Lotpack::SquareTable &squares = lotpack.squares;
+
+        REQUIRE_FALSE(squares.empty());
+        CHECK(squares.roomIds.size() == squares.size());
+        CHECK(squares.tileOffsets.size() == squares.size() + 1);
+        CHECK(squares.tileOffsets.back() == squares.tiles.size());
+
+        // tables are allocated from the validation pass counts
+        CHECK(squares.tiles.capacity() == squares.tiles.size());
+
+        Lotpack copy(&header);
+        copy.magic = lotpack.magic;
+        copy.version = lotpack.version;
+        copy.blocksCount = lotpack.blocksCount;
+
+        for (size_t square = 0; square < squares.size(); square++)
+        {
+            REQUIRE(squares.tileOffsets[square] <= squares.tileOffsets[square + 1]);
+            copy.squares.push(squares.coords[square], squares.roomIds[square], squares.squareTiles(square));
+        }
+
+        CHECK(copy.write() == buffer);
+    }
+
+    TEST_CASE("lazy blocks match the eager decoding")
+    {
+        LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+        Lotpack eager = Lotpack::read(constants::LOTHPACK_PATH, &header);
+        Lotpack lazy = Lotpack::open(FileReader::read(constants::LOTHPACK_PATH), &header);
+
+        REQUIRE(lazy.isLazy());
+        CHECK(lazy.blocksCount == eager.blocksCount);
+        CHECK(lazy.squares.empty());
+        CHECK_FALSE(lazy.isBlockLoaded(0));
+        CHECK_THROWS_AS(lazy.write(), std::runtime_error);
+
+        // 2x3 chunks, the out of cell part is clamped
+        CHECK(lazy.loadChunks(30, -1, 33, 1) == 4);
+        CHECK(lazy.loadChunks(30, 0, 31, 1) == 0);
+        CHECK(lazy.isBlockLoaded(Lotpack::blockIndex(31, 1)));
+        CHECK_FALSE(lazy.isBlockLoaded(Lotpack::blockIndex(29, 1)));
+
+        size_t square = 0;
+
+        for (uint32_t blockIndex = 0; blockIndex < eager.blocksCount; blockIndex++)
+        {
+            Lotpack::SquareView block = lazy.loadBlock(blockIndex);
+
+            for (size_t i = 0; i < block.size(); i++, square++)
+            {
+                REQUIRE(square < eager.squares.size());
+                REQUIRE(block.coords[i] == eager.squares.coords[square]);
+                REQUIRE(block.roomIds[i] == eager.squares.roomIds[square]);
+                REQUIRE(std::ranges::equal(block.squareTiles(i), eager.squares.squareTiles(square)));
+            }
+        }
+
+        CHECK(square == eager.squares.size());
+        CHECK_THROWS_AS(lazy.loadBlock(eager.blocksCount), std::out_of_range);
+
+        // copies share the file and keep the decoded blocks
+        Lotpack copy = lazy;
+        size_t tablesCount = 0;
+        copy.forEachLoadedTable([&](const Lotpack::SquareView &) { tablesCount++; });
+        CHECK(tablesCount == eager.blocksCount);
+    }
+
+    TEST_CASE("parallel decoding gives the serial result")
+    {
+        LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+        BytesBuffer buffer = FileReader::read(constants::LOTHPACK_PATH);
+        Lotpack serial = Lotpack::read(buffer, &header);
+
+        for (size_t threads : { 1, 3, 8 })
+        {
+            Lotpack parallel = Lotpack::readParallel(buffer, &header, threads);
+
+            CHECK(parallel.blocksCount == serial.blocksCount);
+            CHECK(parallel.squares.coords == serial.squares.coords);
+            CHECK(parallel.squares.roomIds == serial.squares.roomIds);
+            CHECK(parallel.squares.tileOffsets == serial.squares.tileOffsets);
+            CHECK(parallel.squares.tiles == serial.squares.tiles);
+            CHECK(parallel.write() == buffer);
+        }
+
+        buffer.resize(buffer.size() - 4);
+        CHECK_THROWS_AS(Lotpack::readParallel(buffer, &header), std::runtime_error);
+    }
+
+    TEST_CASE("square index")
+    {
+        LotHeader header = LotHeader::read(constants::LOTHEADER_PATH);
+        Lotpack lotpack = Lotpack::readParallel(constants::LOTHPACK_PATH, &header);
+
+        CHECK_THROWS_AS(lotpack.getSquare(0, 0, 0), std::runtime_error);
+        lotpack.buildSquareIndex();
+
+        const Lotpack::SquareTable &squares = lotpack.squares;
+        size_t found = 0;
+
+        for (int z = header.minLayer; z < header.maxLayer; z++)
+        {
+            for (int x = 0; x < constants::CELL_SIZE_IN_SQUARE; x++)
+            {
+                for (int y = 0; y < constants::CELL_SIZE_IN_SQUARE; y++)
+                {
+                    std::optional<uint32_t> square = lotpack.getSquare(x, y, z);
+                    if (!square)
+                        continue;
+
+                    CellCoord coord = squares.coords[*square];
+                    REQUIRE(coord.z() == z);
+                    REQUIRE(coord.chunk_idx() == Lotpack::blockIndex(x / constants::BLOCK_SIZE_IN_SQUARE, y / constants::BLOCK_SIZE_IN_SQUARE));
+                    REQUIRE(coord.x() == x % constants::BLOCK_SIZE_IN_SQUARE);
+                    REQUIRE(coord.y() == y % constants::BLOCK_SIZE_IN_SQUARE);
+                    found++;
+                }
+            }
+        }
+
+        CHECK(found == squares.size());
+        CHECK_FALSE(lotpack.getSquare(-1, 0, 0).has_value());
+        CHECK_FALSE(lotpack.getSquare(0, constants::CELL_SIZE_IN_SQUARE, 0).has_value());
+        CHECK_FALSE(lotpack.getSquare(0, 0, header.maxLayer).has_value());
+
+        // squares pushed out of file order can't be ranked
+        Lotpack reversed(&header);
+        reversed.blocksCount = lotpack.blocksCount;
+        for (size_t square = squares.size(); square-- > 0;)
+        {
+            reversed.squares.push(squares.coords[square], squares.roomIds[square], squares.squareTiles(square));
+        }
+        CHECK_THROWS_AS(reversed.buildSquareIndex(), std::runtime_error);
+    }
+}
@@ -0,0 +1,99 @@
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+
+#include "files/map_archive.h"
+#include "io/file_reader.h"
+#include "services/map_files_service.h"
+#include "types.h"
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("MapArchive")
+{
+    TEST_CASE("entries read back as the original files")
+    {
+        fs::path archivePath = fs::temp_directory_path() / "map_archive_test.pzma";
+
+        for (bool compress : { false, true })
+        {
+            CHECK(MapArchive::build("data/B42", archivePath.string(), compress) == 4);
+
+            MapArchive archive = MapArchive::open(archivePath.string());
+            BytesBuffer scratch;
+
+            for (Vector2i position : { Vector2i(1, 38), Vector2i(27, 38) })
+            {
+                std::string name = std::to_string(position.x) + "_" + std::to_string(position.y);
+
+                const MapArchive::Entry *header = archive.find(position, MapArchive::EntryType::LotHeader);
+                const MapArchive::Entry *lotpack = archive.find(position, MapArchive::EntryType::Lotpack);
+
+                REQUIRE(header != nullptr);
+                REQUIRE(lotpack != nullptr);
+                CHECK(((lotpack->flags & MapArchive::FLAG_DEFLATE) != 0) == compress);
+
+                BytesBuffer expectedHeader = FileReader::read("data/B42/" + name + ".lotheader");
+                BytesView headerData = archive.read(*header, scratch);
+                CHECK(BytesBuffer(headerData.begin(), headerData.end()) == expectedHeader);
+
+                BytesBuffer expectedLotpack = FileReader::read("data/B42/world_" + name + ".lotpack");
+                BytesView lotpackData = archive.read(*lotpack, scratch);
+                CHECK(BytesBuffer(lotpackData.begin(), lotpackData.end()) == expectedLotpack);
+            }
+
+            CHECK(archive.find(Vector2i(0, 0), MapArchive::EntryType::LotHeader) == nullptr);
+        }
+
+        fs::remove(archivePath);
+    }
+
+    TEST_CASE("corrupted payload is detected")
+    {
+        fs::path archivePath = fs::temp_directory_path() / "map_archive_corrupted.pzma";
+        MapArchive::build("data/B42", archivePath.string(), false);
+
+        BytesBuffer buffer = FileReader::read(archivePath.string());
+        buffer[MapArchive::HEADER_SIZE + 100] ^= 0xFF;
+        FileReader::save(buffer, archivePath.string());
+
+        {
+            MapArchive archive = MapArchive::open(archivePath.string());
+            BytesBuffer scratch;
+
+            CHECK_THROWS_AS(archive.read(archive.getEntries().front(), scratch), std::runtime_error);
+        }
+
+        fs::remove(archivePath);
+    }
+
+    TEST_CASE("MapFilesService reads cells from the archive")
+    {
+        fs::path archivePath = fs::temp_directory_path() / "map_archive_service.pzma";
+        MapArchive::build("data/B42", archivePath.string());
+
+        // the mapping must be released before the archive can be removed on Windows
+        {
+            MapFilesService service("unused", "unused");
+            service.OpenArchive(archivePath.string());
+
+            std::unique_ptr<Cell> cell = service.LoadCellByPosition(27, 38);
+
+            CHECK(cell->header.position.x == 27);
+            CHECK(cell->header.tileIds == LotHeader::read("data/B42/27_38.lotheader").tileIds);
+            CHECK(cell->lotpack.header == &cell->header);
+            CHECK_FALSE(cell->lotpack.squares.empty());
+            CHECK(service.OpenCellByPosition(27, 38)->lotpack.isLazy());
+
+            // moving a cell keeps its lotpack on its own header
+            Cell moved = std::move(*cell);
+            CHECK(moved.lotpack.header == &moved.header);
+            CHECK(moved.header.position.y == 38);
+            CHECK_THROWS_AS(service.LoadLotheaderByPosition(0, 0), std::runtime_error);
+        }
+
+        fs::remove(archivePath);
+    }
+}
@@ -0,0 +1,71 @@
+#include <doctest/doctest.h>
+#include <filesystem>
+
+#include "core/map_diff.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "files/map_manifest.h"
+#include "temp_directory.h"
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("MapDiff")
+{
+    TEST_CASE("lazy and decoded block hashes match")
+    {
+        LotHeader header = LotHeader::read("data/B42/27_38.lotheader", LotHeader::SECTION_TILE_NAMES);
+        Lotpack decoded = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+        Lotpack lazy = Lotpack::open("data/B42/world_27_38.lotpack", &header);
+
+        std::vector<uint64_t> hashes = decoded.blockHashes(1);
+        CHECK(hashes.size() == decoded.blocksCount);
+        CHECK(lazy.blockHashes(4) == hashes);
+        CHECK_FALSE(lazy.isBlockLoaded(0));
+    }
+
+    TEST_CASE("only modified chunks are reported")
+    {
+        MapManifest original = MapManifest::scan("data/B42");
+
+        MapDiff same = MapDiff::compare(original, original);
+        CHECK(same.cells.empty());
+        CHECK(same.identicalCells == 2);
+
+        TempDirectory temp("map_diff_test");
+        fs::path mapDirectory = temp.copyCells("map");
+
+        // one tile of one square replaced by another tile of the header
+        LotHeader header = LotHeader::read("data/B42/27_38.lotheader", LotHeader::SECTION_TILE_NAMES);
+        Lotpack lotpack = Lotpack::read("data/B42/world_27_38.lotpack", &header);
+        REQUIRE(header.tileIds.size() > 1);
+
+        size_t square = lotpack.squares.size() / 2;
+        int32_t &tile = lotpack.squares.tiles[lotpack.squares.tileOffsets[square]];
+        tile = tile == 0 ? 1 : 0;
+        lotpack.save((mapDirectory / "world_27_38.lotpack").string());
+
+        MapDiff diff = MapDiff::compare(original, MapManifest::scan(mapDirectory.string()));
+        CHECK(diff.identicalCells == 1);
+        REQUIRE(diff.cells.size() == 1);
+        CHECK(diff.cells[0].position.x == 27);
+        CHECK(diff.cells[0].status == MapDiff::CellStatus::Changed);
+        CHECK_FALSE(diff.cells[0].headerChanged);
+
+        REQUIRE(diff.cells[0].chunks.size() == 1);
+        const MapDiff::ChunkChange &chunk = diff.cells[0].chunks[0];
+        CHECK(chunk.squaresChanged == 1);
+        CHECK(chunk.squaresBefore == chunk.squaresAfter);
+        CHECK(Lotpack::blockIndex(chunk.chunkX, chunk.chunkY) == lotpack.squares.coords[square].chunk_idx());
+    }
+
+    TEST_CASE("cells of another format or missing")
+    {
+        MapDiff diff = MapDiff::compare(MapManifest::scan("data/B42"), MapManifest::scan("data/B41"));
+
+        REQUIRE(diff.cells.size() == 2);
+        CHECK(diff.cells[0].position.x == 1);
+        CHECK(diff.cells[0].status == MapDiff::CellStatus::Removed);
+        CHECK(diff.cells[1].position.x == 27);
+        CHECK(diff.cells[1].status == MapDiff::CellStatus::FormatChanged);
+    }
+}
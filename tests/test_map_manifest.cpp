@@ -0,0 +1,59 @@
+#include <doctest/doctest.h>
+#include <filesystem>
+
+#include "files/lotheader.h"
+#include "files/map_manifest.h"
+#include "io/file_reader.h"
+#include "math/fingerprint.h"
+#include "temp_directory.h"
+#include "types.h"
+
+namespace fs = std::filesystem;
+
+TEST_SUITE("MapManifest")
+{
+    TEST_CASE("cell names")
+    {
+        CHECK(LotHeader::parsePositionFromFilename("C:\\maps\\Muldraugh, KY\\12_7.lotheader")->y == 7);
+        CHECK_FALSE(LotHeader::parsePositionFromFilename("world_12_7.lotpack").has_value());
+        CHECK_FALSE(LotHeader::parsePositionFromFilename("12_-7.lotheader").has_value());
+        CHECK_FALSE(LotHeader::parsePositionFromFilename("12_.lotheader").has_value());
+    }
+
+    TEST_CASE("manifest is cached next to the map and refreshed")
+    {
+        TempDirectory temp("map_manifest_test");
+        fs::path mapDirectory = temp.copyCells("map");
+        std::string manifestPath = MapManifest::manifestPath(mapDirectory.string() + "/");
+
+        // a header without its lotpack is not a loadable cell
+        fs::copy_file("data/B42/1_38.lotheader", mapDirectory / "5_5.lotheader");
+
+        MapManifest scanned = MapManifest::load(mapDirectory.string());
+        CHECK(manifestPath == mapDirectory.string() + ".pzmm");
+        REQUIRE(fs::exists(manifestPath));
+
+        REQUIRE(scanned.cells.size() == 2);
+        CHECK(scanned.cells[0].position.x == 1);
+        CHECK(scanned.cells[1].position.x == 27);
+        CHECK(scanned.cells[1].lotpack.size == fs::file_size("data/B42/world_27_38.lotpack"));
+        CHECK(scanned.cells[1].lotpack.hash == Fingerprint::file("data/B42/world_27_38.lotpack"));
+
+        std::optional<MapManifest> cached = MapManifest::read(manifestPath, mapDirectory.string());
+        REQUIRE(cached.has_value());
+        CHECK(cached->write() == scanned.write());
+        CHECK_FALSE(cached->refresh());
+
+        // a cell modified in place is rehashed without listing the directory
+        BytesBuffer otherHeader = FileReader::read("data/B42/27_38.lotheader");
+        FileReader::save(otherHeader, scanned.lotheaderPath(scanned.cells[0]));
+        fs::last_write_time(scanned.lotheaderPath(scanned.cells[0]), fs::file_time_type::clock::now() + std::chrono::seconds(5));
+
+        CHECK(cached->refresh());
+        CHECK(cached->cells[0].lotheader.hash == Fingerprint::file("data/B42/27_38.lotheader"));
+        CHECK(cached->cells[1].lotheader.hash == scanned.cells[1].lotheader.hash);
+
+        MapManifest reloaded = MapManifest::load(mapDirectory.string());
+        CHECK(reloaded.write() == cached->write());
+    }
+}
@@ -0,0 +1,37 @@
+#include <doctest/doctest.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "constants.h"
+#include "io/file_reader.h"
+#include "io/mapped_file.h"
+#include "types.h"
+
+TEST_SUITE("MappedFile")
+{
+    TEST_CASE("mapping matches buffered read")
+    {
+        BytesBuffer buffer = FileReader::read(constants::LOTHEADER_PATH);
+        MappedFile file = FileReader::map(constants::LOTHEADER_PATH);
+
+        REQUIRE(file.size() == buffer.size());
+        CHECK(std::equal(buffer.begin(), buffer.end(), file.view().begin()));
+    }
+
+    TEST_CASE("ownership is transferred on move")
+    {
+        MappedFile file = FileReader::map(constants::LOTHEADER_PATH);
+        const uint8_t *data = file.data();
+
+        MappedFile moved = std::move(file);
+
+        CHECK(moved.data() == data);
+        CHECK(file.data() == nullptr);
+        CHECK(file.empty());
+    }
+
+    TEST_CASE("missing file throws")
+    {
+        CHECK_THROWS_AS(MappedFile("data/missing.lotheader"), std::runtime_error);
+    }
+}
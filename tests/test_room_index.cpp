@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <vector>
+
+#include "constants.h"
+#include "core/room_index.h"
+#include "files/lotheader.h"
+
+TEST_SUITE("RoomIndex")
+{
+    TEST_CASE("queries match a brute force scan")
+    {
+        std::vector<LotHeader> headers = { LotHeader::read("data/B42/1_38.lotheader"), LotHeader::read("data/B42/27_38.lotheader") };
+
+        RoomIndex index;
+        for (const LotHeader &header : headers)
+        {
+            index.addCell(header);
+        }
+        index.build();
+
+        // every room in world coordinates, in index order
+        std::vector<std::vector<RoomIndex::Box>> roomBoxes;
+        for (const LotHeader &header : headers)
+        {
+            for (size_t room = 0; room < header.rooms.roomsCount(); room++)
+            {
+                std::vector<RoomIndex::Box> boxes;
+                for (const LotHeader::Rectangle &rect : header.rooms.roomRectangles(room))
+                {
+                    int32_t x = header.position.x * constants::CELL_SIZE_IN_SQUARE + static_cast<int32_t>(rect.x);
+                    int32_t y = header.position.y * constants::CELL_SIZE_IN_SQUARE + static_cast<int32_t>(rect.y);
+                    boxes.push_back({ x, y, x + static_cast<int32_t>(rect.width), y + static_cast<int32_t>(rect.heigth) });
+                }
+                roomBoxes.push_back(boxes);
+            }
+        }
+
+        REQUIRE(index.roomsCount() == roomBoxes.size());
+        REQUIRE(index.roomsCount() > 0);
+
+        SUBCASE("point")
+        {
+            for (uint32_t room = 0; room < roomBoxes.size(); room++)
+            {
+                for (const RoomIndex::Box &box : roomBoxes[room])
+                {
+                    std::optional<uint32_t> found = index.roomAt(box.x0, box.y0, index.getRoom(room).layer);
+                    REQUIRE(found.has_value());
+
+                    // overlapping rooms may answer first, the square must still be inside the answer
+                    bool inside = std::any_of(roomBoxes[*found].begin(), roomBoxes[*found].end(), [&](const RoomIndex::Box &other) { return other.contains(box.x0, box.y0); });
+                    CHECK(inside);
+                }
+            }
+
+            CHECK_FALSE(index.roomAt(-1000, -1000, 0).has_value());
+        }
+
+        SUBCASE("region")
+        {
+            int32_t originX = 27 * constants::CELL_SIZE_IN_SQUARE;
+            int32_t originY = 38 * constants::CELL_SIZE_IN_SQUARE;
+
+            for (RoomIndex::Box region : { RoomIndex::Box{ originX, originY, originX + 100, originY + 100 }, RoomIndex::Box{ originX + 90, originY + 10, originX + 250, originY + 40 }, RoomIndex::Box{ 0, 0, 1 << 16, 1 << 16 } })
+            {
+                std::vector<uint32_t> expected;
+                for (uint32_t room = 0; room < roomBoxes.size(); room++)
+                {
+                    if (std::any_of(roomBoxes[room].begin(), roomBoxes[room].end(), [&](const RoomIndex::Box &box) { return box.intersects(region); }))
+                        expected.push_back(room);
+                }
+
+                std::vector<uint32_t> found;
+                index.queryRegion(region, found);
+                CHECK(found == expected);
+            }
+        }
+
+        SUBCASE("nearest building")
+        {
+            int32_t x = 27 * constants::CELL_SIZE_IN_SQUARE + 128;
+            int32_t y = 38 * constants::CELL_SIZE_IN_SQUARE + 128;
+
+            int64_t expected = INT64_MAX;
+            for (uint32_t room = 0; room < roomBoxes.size(); room++)
+            {
+                if (index.getRoom(room).building < 0)
+                    continue;
+
+                for (const RoomIndex::Box &box : roomBoxes[room])
+                {
+                    int64_t dx = std::max({ box.x0 - x, 0, x - (box.x1 - 1) });
+                    int64_t dy = std::max({ box.y0 - y, 0, y - (box.y1 - 1) });
+                    expected = std::min(expected, dx * dx + dy * dy);
+                }
+            }
+
+            std::optional<RoomIndex::NearestBuilding> nearest = index.nearestBuilding(x, y, 1000);
+            REQUIRE(nearest.has_value());
+            CHECK(nearest->squaredDistance == expected);
+            CHECK(nearest->cell.x == 27);
+            CHECK_FALSE(index.nearestBuilding(-10000, -10000, 10).has_value());
+        }
+    }
+}
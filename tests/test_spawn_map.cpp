@@ -0,0 +1,64 @@
+#include <doctest/doctest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "core/spawn_map.h"
+#include "files/lotheader.h"
+
+TEST_SUITE("SpawnMap")
+{
+    TEST_CASE("cells are stitched at their position")
+    {
+        std::vector<std::string> paths = { "data/B42/1_38.lotheader", "data/B42/27_38.lotheader" };
+
+        SpawnMap spawnMap = SpawnMap::build(paths, 2);
+
+        CHECK(spawnMap.originCell.x == 1);
+        CHECK(spawnMap.originCell.y == 38);
+        CHECK(spawnMap.widthInChunks == 27 * constants::CELL_SIZE_IN_BLOCKS);
+        CHECK(spawnMap.heightInChunks == constants::CELL_SIZE_IN_BLOCKS);
+
+        for (const std::string &path : paths)
+        {
+            LotHeader header = LotHeader::read(path);
+            int32_t offsetX = (header.position.x - spawnMap.originCell.x) * constants::CELL_SIZE_IN_BLOCKS;
+
+            for (int32_t chunkX = 0; chunkX < constants::CELL_SIZE_IN_BLOCKS; chunkX++)
+            {
+                for (int32_t chunkY = 0; chunkY < constants::CELL_SIZE_IN_BLOCKS; chunkY++)
+                {
+                    REQUIRE(spawnMap.at(offsetX + chunkX, chunkY) == header.spawns[chunkX * constants::CELL_SIZE_IN_BLOCKS + chunkY]);
+                }
+            }
+        }
+
+        // densities read from the spawn bytes of the fixtures, x and y are not interchangeable
+        int32_t cellOffset = 26 * constants::CELL_SIZE_IN_BLOCKS;
+        CHECK(spawnMap.at(0, 8) == 1);
+        CHECK(spawnMap.at(8, 0) == 2);
+        CHECK(spawnMap.at(0, 10) == 2);
+        CHECK(spawnMap.at(10, 0) == 1);
+        CHECK(spawnMap.at(cellOffset + 30, 0) == 2);
+        CHECK(spawnMap.at(cellOffset + 0, 30) == 0);
+
+        // cells missing between the two files stay empty
+        CHECK(spawnMap.at(5 * constants::CELL_SIZE_IN_BLOCKS, 0) == 0);
+        CHECK(spawnMap.at(-1, 0) == 0);
+        CHECK_FALSE(spawnMap.toPNG().empty());
+    }
+
+    TEST_CASE("B41 cells are 30 chunks wide")
+    {
+        SpawnMap spawnMap = SpawnMap::build(std::vector<std::string>{ "data/B41/27_38.lotheader" });
+
+        CHECK(spawnMap.cellSizeInChunks == constants::B41_CELL_SIZE_IN_BLOCKS);
+        CHECK(spawnMap.widthInChunks == constants::B41_CELL_SIZE_IN_BLOCKS);
+        CHECK(spawnMap.heightInChunks == constants::B41_CELL_SIZE_IN_BLOCKS);
+        CHECK(spawnMap.at(0, 2) == 102);
+        CHECK(spawnMap.at(2, 0) == 84);
+
+        CHECK_THROWS_AS(SpawnMap::build(std::vector<std::string>{ "data/B41/27_38.lotheader", "data/B42/1_38.lotheader" }), std::runtime_error);
+    }
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <iterator>
+#include <map>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "core/sprite_index.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+#include "files/map_manifest.h"
+
+TEST_SUITE("SpriteIndex")
+{
+    TEST_CASE("postings match a scan of the squares")
+    {
+        MapManifest manifest = MapManifest::scan("data/B42");
+        SpriteIndex index = SpriteIndex::build(manifest, 2);
+
+        // brute force: every (sprite, square) pair of the two cells
+        std::map<uint32_t, std::set<uint64_t>> expected;
+
+        for (const MapManifest::Cell &cell : manifest.cells)
+        {
+            LotHeader header = LotHeader::read(manifest.lotheaderPath(cell));
+            Lotpack lotpack = Lotpack::read(manifest.lotpackPath(cell), &header);
+
+            for (size_t square = 0; square < lotpack.squares.size(); square++)
+            {
+                CellCoord coord = lotpack.squares.coords[square];
+                int32_t x = cell.position.x * 256 + (coord.chunk_idx() / 32) * 8 + coord.x();
+                int32_t y = cell.position.y * 256 + (coord.chunk_idx() % 32) * 8 + coord.y();
+
+                for (int32_t tile : lotpack.squares.squareTiles(square))
+                {
+                    expected[header.tileIds[tile]].insert(SpriteIndex::packPosition(x, y, coord.z()));
+                }
+            }
+        }
+
+        REQUIRE(index.spritesCount() == expected.size());
+
+        for (const auto &[spriteId, positions] : expected)
+        {
+            std::span<const uint64_t> postings = index.postingsOf(spriteId);
+            REQUIRE(std::equal(postings.begin(), postings.end(), positions.begin(), positions.end()));
+        }
+
+        SpriteIndex::Position position = SpriteIndex::unpackPosition(SpriteIndex::packPosition(7000, 9800, -3));
+        CHECK(position.x == 7000);
+        CHECK(position.y == 9800);
+        CHECK(position.z == -3);
+
+        SUBCASE("intersection")
+        {
+            // the two most used sprites
+            std::vector<uint32_t> sprites(index.getSpriteIds().begin(), index.getSpriteIds().end());
+            std::sort(sprites.begin(), sprites.end(), [&](uint32_t a, uint32_t b) { return expected[a].size() > expected[b].size(); });
+            sprites.resize(2);
+
+            std::vector<uint64_t> brute;
+            std::set_intersection(expected[sprites[0]].begin(), expected[sprites[0]].end(), expected[sprites[1]].begin(), expected[sprites[1]].end(), std::back_inserter(brute));
+
+            std::vector<uint64_t> found;
+            index.intersect(sprites, found);
+            CHECK(found == brute);
+
+            index.intersect(std::vector<uint32_t>{ sprites[0] }, found);
+            CHECK(found.size() == expected[sprites[0]].size());
+
+            index.intersect(std::vector<uint32_t>{ sprites[0], UINT32_MAX }, found);
+            CHECK(found.empty());
+        }
+
+        SUBCASE("persistence")
+        {
+            BytesBuffer buffer = index.write();
+            SpriteIndex loaded = SpriteIndex::read(buffer);
+
+            CHECK(loaded.spritesCount() == index.spritesCount());
+            CHECK(loaded.write() == buffer);
+
+            for (uint32_t spriteId : index.getSpriteIds())
+            {
+                std::span<const uint64_t> a = index.postingsOf(spriteId);
+                std::span<const uint64_t> b = loaded.postingsOf(spriteId);
+                REQUIRE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+            }
+
+            buffer.resize(buffer.size() - 1);
+            CHECK_THROWS_AS(SpriteIndex::read(buffer), std::runtime_error);
+        }
+    }
+}
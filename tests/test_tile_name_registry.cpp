@@ -0,0 +1,58 @@
+#include <doctest/doctest.h>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "core/tile_name_registry.h"
+#include "files/lotheader.h"
+#include "files/lotpack.h"
+
+TEST_SUITE("TileNameRegistry")
+{
+    TEST_CASE("names are interned once")
+    {
+        TileNameRegistry registry;
+
+        uint32_t first = registry.intern("floors_exterior_natural_01_0");
+        uint32_t second = registry.intern("walls_exterior_house_01_0");
+
+        CHECK(first == 0);
+        CHECK(second == 1);
+        CHECK(registry.intern(std::string("floors_exterior_natural_01_0")) == first);
+        CHECK(registry.name(second) == "walls_exterior_house_01_0");
+        CHECK(registry.find("missing") == UINT32_MAX);
+
+        std::array<std::string_view, 3> names = { "walls_exterior_house_01_0", "blends_natural_01_5", "walls_exterior_house_01_0" };
+        std::array<uint32_t, 3> ids{};
+        registry.intern(names, ids);
+
+        CHECK(ids == std::array<uint32_t, 3>{ 1, 2, 1 });
+        CHECK(registry.size() == 3);
+    }
+
+    TEST_CASE("cells share the global ids")
+    {
+        LotHeader first = LotHeader::read("data/B42/27_38.lotheader");
+        LotHeader second = LotHeader::read("data/B42/1_38.lotheader");
+
+        TileNameRegistry &registry = TileNameRegistry::global();
+
+        for (size_t i = 0; i < second.tileIds.size(); i++)
+        {
+            CHECK(registry.find(second.tileName(i)) == second.tileIds[i]);
+        }
+
+        Lotpack lotpack = Lotpack::read("data/B42/world_27_38.lotpack", &first);
+        std::span<const int32_t> tiles = lotpack.squares.squareTiles(0);
+
+        std::vector<uint32_t> globalIds(tiles.size());
+        first.toGlobalTileIds(tiles, globalIds);
+
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            CHECK(registry.name(globalIds[i]) == first.tileName(tiles[i]));
+        }
+    }
+}